@@ -13,6 +13,7 @@ void add_source_to_scalar_flux_kernel(Parameters P, SimulationData SD, int cell,
   float * new_scalar_flux         = SD.readWriteData.cellData.new_scalar_flux;
   float * isotropic_source        = SD.readWriteData.cellData.isotropic_source; 
   float * scalar_flux_accumulator = SD.readWriteData.cellData.scalar_flux_accumulator; 
+  float * scalar_flux_sum_of_squares_accumulator = SD.readWriteData.cellData.scalar_flux_sum_of_squares_accumulator;
 
   uint64_t idx = (uint64_t) cell * P.n_energy_groups + energy_group;
 
@@ -20,4 +21,6 @@ void add_source_to_scalar_flux_kernel(Parameters P, SimulationData SD, int cell,
   new_scalar_flux[idx] += isotropic_source[idx];
 
   scalar_flux_accumulator[idx] += new_scalar_flux[idx];
+  if( scalar_flux_sum_of_squares_accumulator != NULL )
+    scalar_flux_sum_of_squares_accumulator[idx] += new_scalar_flux[idx] * new_scalar_flux[idx];
 }
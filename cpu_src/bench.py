@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+"""Scaling benchmark driver for minray.
+
+Runs ./minray over a sweep of thread counts, problem size multipliers (-m),
+ray counts (-r) and ray distances (-d) for the default problem, along with any
+requested validation problems, and gathers each run's --summary JSON output
+into a single benchmark file.
+
+The compare mode matches the runs of two benchmark files by configuration and
+flags any whose time per integration (TPI) has increased by more than a
+threshold percentage.
+
+Examples:
+    ./bench.py run -o bench.json
+    ./bench.py run -t 1,2,4,8 -m 4,16 -r default,100000 -d 10,20 -v small,medium
+    ./bench.py compare baseline.json bench.json --threshold 5
+"""
+
+import argparse
+import datetime
+import itertools
+import json
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+
+BENCH_FORMAT_VERSION = 1
+
+
+def parse_list(value, convert):
+    # "default" means the option is not passed, leaving minray's own default
+    return [None if v == "default" else convert(v) for v in value.split(",") if v]
+
+
+def build_cases(args):
+    cases = []
+    for m, r, d in itertools.product(args.multipliers, args.rays, args.distances):
+        cmd = ["-m", str(m), "-s", str(args.seed)]
+        if r is not None:
+            cmd += ["-r", str(r)]
+        if d is not None:
+            cmd += ["-d", str(d)]
+        if args.inactive is not None:
+            cmd += ["-i", str(args.inactive)]
+        if args.active is not None:
+            cmd += ["-a", str(args.active)]
+        cases.append({"problem": "default", "multiplier": m, "rays": r, "distance": d, "args": cmd})
+
+    # Validation problems fix their own mesh, iterations and seed
+    for v in args.validation:
+        cases.append({"problem": v, "multiplier": None, "rays": None, "distance": None, "args": ["-v", v]})
+    return cases
+
+
+def case_key(run):
+    return (run["problem"], run["multiplier"], run["rays"], run["distance"], run["threads"])
+
+
+def case_label(run):
+    label = run["problem"]
+    for name, field in (("m", "multiplier"), ("r", "rays"), ("d", "distance")):
+        if run[field] is not None:
+            label += " %s=%s" % (name, run[field])
+    return label + " threads=%d" % run["threads"]
+
+
+def run_case(binary, case, threads, extra_args):
+    with tempfile.NamedTemporaryFile(suffix=".json", delete=False) as f:
+        summary_file = f.name
+
+    cmd = [binary] + case["args"] + extra_args + ["--summary", summary_file]
+    env = dict(os.environ, OMP_NUM_THREADS=str(threads))
+    proc = subprocess.run(cmd, env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+
+    try:
+        with open(summary_file) as f:
+            summary = json.load(f)
+    except (OSError, ValueError):
+        summary = None
+    finally:
+        os.remove(summary_file)
+
+    if summary is None:
+        sys.stderr.write("ERROR: \"%s\" did not produce a summary\n%s\n" % (" ".join(cmd), proc.stdout))
+        sys.exit(1)
+
+    run = dict(case)
+    run["threads"] = threads
+    run["command"] = " ".join(cmd[:-2])
+    run["exit_code"] = proc.returncode
+    run["summary"] = summary
+    return run
+
+
+def run_benchmarks(args):
+    runs = []
+    extra_args = args.extra.split()
+    for case in build_cases(args):
+        for threads in args.threads:
+            run = run_case(args.binary, case, threads, extra_args)
+            results = run["summary"]["results"]
+            print("%-50s TPI = %8.3f [ns]  runtime = %.3e [s]  k-eff = %.5f" %
+                  (case_label(run), results["time_per_integration_ns"], results["runtime_total"], results["k_eff"]))
+            sys.stdout.flush()
+            runs.append(run)
+
+    bench = {
+        "format_version": BENCH_FORMAT_VERSION,
+        "date": datetime.datetime.now().isoformat(timespec="seconds"),
+        "host": platform.node(),
+        "machine": platform.machine(),
+        "runs": runs,
+    }
+    with open(args.output, "w") as f:
+        json.dump(bench, f, indent=2)
+    print("Wrote %d runs to %s" % (len(runs), args.output))
+
+    # Validation failures are reported, but do not stop the remaining runs
+    failed = [r for r in runs if r["problem"] != "default" and not r["summary"]["results"]["validation_passed"]]
+    for r in failed:
+        print("VALIDATION FAILED: %s" % case_label(r))
+    return 1 if failed else 0
+
+
+def load_runs(fname):
+    with open(fname) as f:
+        bench = json.load(f)
+    if bench.get("format_version") != BENCH_FORMAT_VERSION:
+        sys.stderr.write("ERROR: \"%s\" is not a version %d benchmark file\n" % (fname, BENCH_FORMAT_VERSION))
+        sys.exit(1)
+    return {case_key(r): r for r in bench["runs"]}
+
+
+def compare_benchmarks(args):
+    baseline = load_runs(args.baseline)
+    current = load_runs(args.current)
+
+    n_regressions = 0
+    print("%-50s %10s %10s %9s" % ("Case", "Base TPI", "New TPI", "Change"))
+    for key, run in current.items():
+        if key not in baseline:
+            print("%-50s %10s %10.3f %9s" % (case_label(run), "-", run["summary"]["results"]["time_per_integration_ns"], "new"))
+            continue
+        old_tpi = baseline[key]["summary"]["results"]["time_per_integration_ns"]
+        new_tpi = run["summary"]["results"]["time_per_integration_ns"]
+        change = 100.0 * (new_tpi - old_tpi) / old_tpi
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            n_regressions += 1
+        print("%-50s %10.3f %10.3f %+8.2f%%%s" % (case_label(run), old_tpi, new_tpi, change, flag))
+
+    missing = [k for k in baseline if k not in current]
+    if missing:
+        print("%d baseline cases were not run" % len(missing))
+
+    print("%d TPI regressions above %.1f%%" % (n_regressions, args.threshold))
+    return 1 if n_regressions else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="minray scaling benchmark suite")
+    sub = parser.add_subparsers(dest="mode")
+    sub.required = True
+
+    run = sub.add_parser("run", help="run the benchmark sweep")
+    run.add_argument("-b", "--binary", default="./minray", help="minray executable (default ./minray)")
+    run.add_argument("-t", "--threads", default=str(os.cpu_count() or 1),
+                     type=lambda v: parse_list(v, int), help="comma separated thread counts (default all cores)")
+    run.add_argument("-m", "--multipliers", default="4,16",
+                     type=lambda v: parse_list(v, int), help="comma separated problem size multipliers (default 4,16)")
+    run.add_argument("-r", "--rays", default="default",
+                     type=lambda v: parse_list(v, int), help="comma separated ray counts, or \"default\"")
+    run.add_argument("-d", "--distances", default="default",
+                     type=lambda v: parse_list(v, float), help="comma separated ray distances, or \"default\"")
+    run.add_argument("-v", "--validation", default="small",
+                     type=lambda v: [] if v == "none" else parse_list(v, str),
+                     help="comma separated validation problems, or \"none\" (default small)")
+    run.add_argument("-s", "--seed", type=int, default=1337, help="random number seed of the default problem (default 1337)")
+    run.add_argument("-i", "--inactive", type=int, help="inactive iterations of the default problem")
+    run.add_argument("-a", "--active", type=int, help="active iterations of the default problem")
+    run.add_argument("-x", "--extra", default="", help="extra minray options passed to every run (e.g. \"--sweep fused\")")
+    run.add_argument("-o", "--output", default="bench.json", help="benchmark output file (default bench.json)")
+
+    compare = sub.add_parser("compare", help="flag TPI regressions against a baseline")
+    compare.add_argument("baseline", help="baseline benchmark file")
+    compare.add_argument("current", help="new benchmark file")
+    compare.add_argument("--threshold", type=float, default=5.0, help="allowed TPI increase in percent (default 5)")
+
+    args = parser.parse_args()
+    if args.mode == "run":
+        return run_benchmarks(args)
+    return compare_benchmarks(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
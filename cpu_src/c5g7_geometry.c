@@ -0,0 +1,105 @@
+#include "minray.h"
+#include "cell_order.h"
+
+// Procedural generation of the 2D C5G7 material map for any mesh resolution.
+// The core is a 3x3 grid of 17x17 pin lattices: two UO2 and two MOX fuel
+// assemblies in the lower left corner (y is increasing from the top row of the
+// material file), with the remaining five assemblies being moderator
+// reflector. Each pin cell is divided into an integer number of mesh cells per
+// dimension, and a mesh cell takes on the material of its pin if the cell's
+// center lies within the fuel pin radius, and is moderator otherwise. This is
+// the same rule that was used to generate the material_ids_<N>.txt files, so
+// the maps produced here match those files exactly.
+
+#define C5G7_PINS_PER_ASSEMBLY 17
+#define C5G7_ASSEMBLIES_PER_DIMENSION 3
+#define C5G7_PIN_RADIUS 0.54
+
+// Pin layouts, using the material ids of the KEY in io.c
+static const char * C5G7_UO2_LATTICE[C5G7_PINS_PER_ASSEMBLY] = {
+  "00000000000000000",
+  "00000000000000000",
+  "00000500500500000",
+  "00050000000005000",
+  "00000000000000000",
+  "00500500500500500",
+  "00000000000000000",
+  "00000000000000000",
+  "00500500400500500",
+  "00000000000000000",
+  "00000000000000000",
+  "00500500500500500",
+  "00000000000000000",
+  "00050000000005000",
+  "00000500500500000",
+  "00000000000000000",
+  "00000000000000000"
+};
+
+static const char * C5G7_MOX_LATTICE[C5G7_PINS_PER_ASSEMBLY] = {
+  "11111111111111111",
+  "12222222222222221",
+  "12222522522522221",
+  "12252333333325221",
+  "12223333333332221",
+  "12533533533533521",
+  "12233333333333221",
+  "12233333333333221",
+  "12533533433533521",
+  "12233333333333221",
+  "12233333333333221",
+  "12533533533533521",
+  "12223333333332221",
+  "12252333333325221",
+  "12222522522522221",
+  "12222222222222221",
+  "11111111111111111"
+};
+
+// Returns the material of the pin containing a given pin index. Assemblies along
+// the top row and the right column are reflector, while the fuel assemblies
+// alternate between UO2 and MOX in a checkerboard pattern.
+int get_c5g7_pin_material(int pin_x, int pin_y)
+{
+  int assembly_x = pin_x / C5G7_PINS_PER_ASSEMBLY;
+  int assembly_y = pin_y / C5G7_PINS_PER_ASSEMBLY;
+
+  if( assembly_x == C5G7_ASSEMBLIES_PER_DIMENSION - 1 || assembly_y == 0 )
+    return 6;
+
+  const char ** lattice = ((assembly_x + assembly_y) % 2 == 0) ? C5G7_UO2_LATTICE : C5G7_MOX_LATTICE;
+  return lattice[pin_y % C5G7_PINS_PER_ASSEMBLY][pin_x % C5G7_PINS_PER_ASSEMBLY] - '0';
+}
+
+// Generates the material id of all cells, stored in the cell numbering in use
+int * generate_2D_C5G7_material_ids(Parameters P)
+{
+  int n_pins_per_dimension = C5G7_PINS_PER_ASSEMBLY * C5G7_ASSEMBLIES_PER_DIMENSION;
+  if( P.n_cells_per_dimension % n_pins_per_dimension != 0 )
+  {
+    printf("ERROR: The number of cells per dimension (%d) must be a multiple of %d to generate the C5G7 geometry\n", P.n_cells_per_dimension, n_pins_per_dimension);
+    exit(1);
+  }
+
+  int cells_per_pin = P.n_cells_per_dimension / n_pins_per_dimension;
+  double pin_pitch = P.length_per_dimension / n_pins_per_dimension;
+  double radius_squared = C5G7_PIN_RADIUS * C5G7_PIN_RADIUS;
+
+  int * material_id = (int *) malloc(P.n_cells * sizeof(int));
+
+  #pragma omp parallel for schedule(static)
+  for( int y = 0; y < P.n_cells_per_dimension; y++ )
+  {
+    double dy = ((y % cells_per_pin) + 0.5) * P.cell_width - 0.5 * pin_pitch;
+    for( int x = 0; x < P.n_cells_per_dimension; x++ )
+    {
+      double dx = ((x % cells_per_pin) + 0.5) * P.cell_width - 0.5 * pin_pitch;
+      int material = get_c5g7_pin_material(x / cells_per_pin, y / cells_per_pin);
+      if( dx * dx + dy * dy > radius_squared )
+        material = 6;
+      material_id[get_cell_id(P, x, y)] = material;
+    }
+  }
+
+  return material_id;
+}
@@ -0,0 +1,65 @@
+#include "minray.h"
+
+// By default, cells are numbered in row-major order (cell_id = y_idx * N + x_idx),
+// so a ray moving in the y direction jumps a full row of every per-cell array at
+// each crossing. With the Morton (Z-order) numbering, cells are instead numbered
+// by recursively visiting the four quadrants of the mesh, so that cells which are
+// close in space are also close in memory regardless of the ray's direction. As
+// the number of cells per dimension is generally not a power of two, quadrants
+// falling entirely outside of the mesh are skipped, leaving a dense numbering.
+
+// Assigns consecutive cell ids to all cells within a square quadrant of the mesh
+void number_morton_quadrant(Parameters P, int x0, int y0, int size, int * next_cell_id)
+{
+  if( x0 >= P.n_cells_per_dimension || y0 >= P.n_cells_per_dimension )
+    return;
+
+  if( size == 1 )
+  {
+    int cartesian_idx = y0 * P.n_cells_per_dimension + x0;
+    P.cell_index[cartesian_idx] = *next_cell_id;
+    P.cartesian_index[*next_cell_id] = cartesian_idx;
+    (*next_cell_id)++;
+    return;
+  }
+
+  // Visit quadrants in the same order as morton_encode() (x occupies the lower bit)
+  int half = size / 2;
+  number_morton_quadrant(P, x0,        y0,        half, next_cell_id);
+  number_morton_quadrant(P, x0 + half, y0,        half, next_cell_id);
+  number_morton_quadrant(P, x0,        y0 + half, half, next_cell_id);
+  number_morton_quadrant(P, x0 + half, y0 + half, half, next_cell_id);
+}
+
+// Builds the tables mapping between Cartesian (row-major) cell indices and cell ids
+void initialize_cell_order(Parameters * P)
+{
+  P->cell_index = NULL;
+  P->cartesian_index = NULL;
+  if( P->cell_order == ROW_MAJOR_CELLS )
+    return;
+
+  P->cell_index      = (int *) malloc(P->n_cells * sizeof(int));
+  P->cartesian_index = (int *) malloc(P->n_cells * sizeof(int));
+
+  int size = 1;
+  while( size < P->n_cells_per_dimension )
+    size *= 2;
+
+  int next_cell_id = 0;
+  number_morton_quadrant(*P, 0, 0, size, &next_cell_id);
+  assert(next_cell_id == P->n_cells);
+}
+
+void free_cell_order(Parameters P)
+{
+  free(P.cell_index);
+  free(P.cartesian_index);
+}
+
+size_t cell_order_memory_usage(Parameters P)
+{
+  if( P.cell_order == ROW_MAJOR_CELLS )
+    return 0;
+  return 2 * P.n_cells * sizeof(int);
+}
@@ -0,0 +1,28 @@
+// Helpers for converting between Cartesian cell indices and cell ids. With the
+// default row-major numbering these reduce to simple arithmetic, while other
+// numberings (see cell_order.c) go through the precomputed permutation tables.
+
+static inline int get_cell_id(Parameters P, int x_idx, int y_idx)
+{
+  int cartesian_idx = y_idx * P.n_cells_per_dimension + x_idx;
+  if( P.cell_order == ROW_MAJOR_CELLS )
+    return cartesian_idx;
+  return P.cell_index[cartesian_idx];
+}
+
+static inline int get_cartesian_index(Parameters P, int cell_id)
+{
+  if( P.cell_order == ROW_MAJOR_CELLS )
+    return cell_id;
+  return P.cartesian_index[cell_id];
+}
+
+static inline int get_cell_x_idx(Parameters P, int cell_id)
+{
+  return get_cartesian_index(P, cell_id) % P.n_cells_per_dimension;
+}
+
+static inline int get_cell_y_idx(Parameters P, int cell_id)
+{
+  return get_cartesian_index(P, cell_id) / P.n_cells_per_dimension;
+}
@@ -0,0 +1,205 @@
+#include "minray.h"
+
+// Checkpoint files hold the full state of the power iteration at the end of an
+// iteration, so that a run can be continued from it (e.g., after the job was
+// preempted, or to run several active phases from one converged inactive
+// phase). All other data (sources, segments, tallies, CMFD data) is rebuilt
+// from this state each iteration. Rays are only sampled once, at startup, so
+// the random number generator state is just the seed, which is checked (along
+// with the mesh, energy groups, source approximation, ray count and ray length)
+// against the restarted run. As all arrays are restored exactly, a restarted run reproduces the
+// original bit-for-bit on the same number of threads, provided the original is
+// itself reproducible (i.e., does not use the atomic tally, whose summation
+// order varies from run to run).
+//
+// File layout:
+//   CheckpointHeader (including the CheckpointState)
+//   old_scalar_flux                        [n_cells][n_energy_groups] (float)
+//   scalar_flux_accumulator                [n_cells][n_energy_groups] (float)
+//   scalar_flux_total                      [n_cells][n_energy_groups] (double)
+//   scalar_flux_sum_of_squares_accumulator [n_cells][n_energy_groups] (float, if present)
+//   scalar_flux_sum_of_squares_total       [n_cells][n_energy_groups] (double, if present)
+//   old_flux_gradient                      [n_cells][n_flux_gradient_entries] (float, linear source only)
+//   angular_flux                           [n_rays][n_energy_groups]  (float)
+//   location_x, location_y                 [n_rays]                   (double)
+//   direction_x, direction_y               [n_rays]                   (double)
+//   cell_id                                [n_rays]                   (int)
+//   entropy and k-eff histories            [n_history]                (double)
+//
+// The file is first written under a temporary name and then renamed, so a job
+// killed while writing leaves the previous checkpoint intact.
+
+CheckpointHeader build_checkpoint_header(Parameters P)
+{
+  CheckpointHeader header;
+  memset(&header, 0, sizeof(CheckpointHeader));
+  memcpy(header.magic, CHECKPOINT_FILE_MAGIC, sizeof(header.magic));
+  header.version = CHECKPOINT_FILE_VERSION;
+  header.n_energy_groups = P.n_energy_groups;
+  header.n_cells_per_dimension = P.n_cells_per_dimension;
+  header.cell_order = P.cell_order;
+  header.source_type = P.source_type;
+  header.n_rays = P.n_rays;
+  header.seed = P.seed;
+  header.distance_per_ray = P.distance_per_ray;
+  return header;
+}
+
+void write_checkpoint_section(FILE * fp, const void * data, size_t size)
+{
+  if( fwrite(data, 1, size, fp) != size )
+  {
+    printf("ERROR: Unable to write checkpoint file\n");
+    exit(1);
+  }
+}
+
+void read_checkpoint_section(FILE * fp, void * data, size_t size, const char * fname)
+{
+  if( fread(data, 1, size, fp) != size )
+  {
+    printf("ERROR: Checkpoint file \"%s\" is truncated\n", fname);
+    exit(1);
+  }
+}
+
+void write_checkpoint(Parameters P, SimulationData SD, CheckpointState state, double * entropy_history, double * k_eff_history)
+{
+  char tmp_fname[1024];
+  snprintf(tmp_fname, sizeof(tmp_fname), "%s.tmp", P.checkpoint_file);
+  FILE * fp = fopen(tmp_fname, "wb");
+  if( fp == NULL )
+  {
+    printf("ERROR: Unable to open checkpoint file \"%s\" for writing\n", tmp_fname);
+    exit(1);
+  }
+
+  CellData CD = SD.readWriteData.cellData;
+  RayData RD = SD.readWriteData.rayData;
+
+  CheckpointHeader header = build_checkpoint_header(P);
+  header.has_flux_sum_of_squares = CD.scalar_flux_sum_of_squares_accumulator != NULL;
+  // The histories are only needed until the automatic inactive phase has ended
+  if( entropy_history != NULL && !state.is_active_region && state.source_converged_iteration < 0 )
+    header.n_history = state.iteration;
+  header.state = state;
+
+  size_t cell_sz = P.n_cells * P.n_energy_groups * sizeof(float);
+  size_t gradient_sz = P.n_cells * P.n_flux_gradient_entries * sizeof(float);
+  write_checkpoint_section(fp, &header, sizeof(CheckpointHeader));
+  write_checkpoint_section(fp, CD.old_scalar_flux, cell_sz);
+  write_checkpoint_section(fp, CD.scalar_flux_accumulator, cell_sz);
+  write_checkpoint_section(fp, CD.scalar_flux_total, 2 * cell_sz);
+  if( header.has_flux_sum_of_squares )
+  {
+    write_checkpoint_section(fp, CD.scalar_flux_sum_of_squares_accumulator, cell_sz);
+    write_checkpoint_section(fp, CD.scalar_flux_sum_of_squares_total, 2 * cell_sz);
+  }
+  if( P.source_type == LINEAR_SOURCE )
+    write_checkpoint_section(fp, CD.old_flux_gradient, gradient_sz);
+  write_checkpoint_section(fp, RD.angular_flux, P.n_rays * P.n_energy_groups * sizeof(float));
+  write_checkpoint_section(fp, RD.location_x,  P.n_rays * sizeof(double));
+  write_checkpoint_section(fp, RD.location_y,  P.n_rays * sizeof(double));
+  write_checkpoint_section(fp, RD.direction_x, P.n_rays * sizeof(double));
+  write_checkpoint_section(fp, RD.direction_y, P.n_rays * sizeof(double));
+  write_checkpoint_section(fp, RD.cell_id,     P.n_rays * sizeof(int));
+  if( header.n_history > 0 )
+  {
+    write_checkpoint_section(fp, entropy_history, header.n_history * sizeof(double));
+    write_checkpoint_section(fp, k_eff_history,   header.n_history * sizeof(double));
+  }
+
+  if( fclose(fp) != 0 || rename(tmp_fname, P.checkpoint_file) != 0 )
+  {
+    printf("ERROR: Unable to write checkpoint file \"%s\"\n", P.checkpoint_file);
+    exit(1);
+  }
+}
+
+// Restores the simulation data from a checkpoint, returning the power iteration state
+CheckpointState read_checkpoint(Parameters P, SimulationData SD, double * entropy_history, double * k_eff_history)
+{
+  printf("Restarting from checkpoint file \"%s\"...\n", P.restart_file);
+  FILE * fp = fopen(P.restart_file, "rb");
+  if( fp == NULL )
+  {
+    printf("ERROR: Checkpoint file \"%s\" not found\n", P.restart_file);
+    exit(1);
+  }
+
+  CheckpointHeader header;
+  read_checkpoint_section(fp, &header, sizeof(CheckpointHeader), P.restart_file);
+  if( memcmp(header.magic, CHECKPOINT_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != CHECKPOINT_FILE_VERSION )
+  {
+    printf("ERROR: \"%s\" is not a version %d minray checkpoint file\n", P.restart_file, CHECKPOINT_FILE_VERSION);
+    exit(1);
+  }
+
+  CheckpointHeader expected = build_checkpoint_header(P);
+  if( header.n_energy_groups != expected.n_energy_groups || header.n_cells_per_dimension != expected.n_cells_per_dimension ||
+      header.cell_order != expected.cell_order || header.source_type != expected.source_type || header.n_rays != expected.n_rays ||
+      header.seed != expected.seed || header.distance_per_ray != expected.distance_per_ray )
+  {
+    printf("ERROR: Checkpoint file \"%s\" was written by a simulation with %u cells per dimension, %u energy groups,\n"
+           "a %s source, %lu rays of length %.2lf [cm], and seed %lu, which does not match this simulation\n",
+           P.restart_file, header.n_cells_per_dimension, header.n_energy_groups, (header.source_type == LINEAR_SOURCE) ? "linear" : "flat",
+           header.n_rays, header.distance_per_ray, header.seed);
+    exit(1);
+  }
+
+  CheckpointState state = header.state;
+  CellData CD = SD.readWriteData.cellData;
+  RayData RD = SD.readWriteData.rayData;
+  size_t cell_sz = P.n_cells * P.n_energy_groups * sizeof(float);
+  size_t gradient_sz = P.n_cells * P.n_flux_gradient_entries * sizeof(float);
+
+  read_checkpoint_section(fp, CD.old_scalar_flux, cell_sz, P.restart_file);
+  read_checkpoint_section(fp, CD.scalar_flux_accumulator, cell_sz, P.restart_file);
+  read_checkpoint_section(fp, CD.scalar_flux_total, 2 * cell_sz, P.restart_file);
+  if( header.has_flux_sum_of_squares )
+  {
+    if( CD.scalar_flux_sum_of_squares_accumulator != NULL )
+    {
+      read_checkpoint_section(fp, CD.scalar_flux_sum_of_squares_accumulator, cell_sz, P.restart_file);
+      read_checkpoint_section(fp, CD.scalar_flux_sum_of_squares_total, 2 * cell_sz, P.restart_file);
+    }
+    else
+      fseek(fp, 3 * cell_sz, SEEK_CUR);
+  }
+  else if( CD.scalar_flux_sum_of_squares_accumulator != NULL )
+  {
+    // The flux uncertainty can only be picked up from the start of the active iterations
+    if( state.is_active_region )
+    {
+      printf("ERROR: Checkpoint file \"%s\" has no flux sum of squares, so cannot be restarted with a flux precision target\n", P.restart_file);
+      exit(1);
+    }
+    memset(CD.scalar_flux_sum_of_squares_accumulator, 0, cell_sz);
+    memset(CD.scalar_flux_sum_of_squares_total, 0, 2 * cell_sz);
+  }
+  if( P.source_type == LINEAR_SOURCE )
+    read_checkpoint_section(fp, CD.old_flux_gradient, gradient_sz, P.restart_file);
+  read_checkpoint_section(fp, RD.angular_flux, P.n_rays * P.n_energy_groups * sizeof(float), P.restart_file);
+  read_checkpoint_section(fp, RD.location_x,  P.n_rays * sizeof(double), P.restart_file);
+  read_checkpoint_section(fp, RD.location_y,  P.n_rays * sizeof(double), P.restart_file);
+  read_checkpoint_section(fp, RD.direction_x, P.n_rays * sizeof(double), P.restart_file);
+  read_checkpoint_section(fp, RD.direction_y, P.n_rays * sizeof(double), P.restart_file);
+  read_checkpoint_section(fp, RD.cell_id,     P.n_rays * sizeof(int),    P.restart_file);
+
+  // Automatic inactive iterations need the histories up to the restart
+  if( entropy_history != NULL && !state.is_active_region && state.source_converged_iteration < 0 )
+  {
+    if( header.n_history != state.iteration || state.iteration > P.n_inactive_iterations )
+    {
+      printf("ERROR: Checkpoint file \"%s\" cannot continue automatic inactive iterations (it was written without\n"
+             "--auto-inactive, or past the -i maximum of this simulation)\n", P.restart_file);
+      exit(1);
+    }
+    read_checkpoint_section(fp, entropy_history, header.n_history * sizeof(double), P.restart_file);
+    read_checkpoint_section(fp, k_eff_history,   header.n_history * sizeof(double), P.restart_file);
+  }
+
+  fclose(fp);
+  printf("Checkpoint loaded. Continuing from iteration %d.\n", state.iteration);
+  return state;
+}
@@ -0,0 +1,468 @@
+#include "minray.h"
+#include "cell_order.h"
+
+// Coarse mesh finite difference (CMFD) acceleration of the power iteration.
+//
+// During the transport sweep, the net angular flux crossing each surface of a
+// coarse mesh of pin cells is tallied, along with the leakage out
+// through vacuum boundaries (see cmfd.h). After the sweep, the fine mesh scalar
+// flux and cross sections are homogenized onto the coarse mesh, and the tallied
+// currents are used to compute the nonlinear diffusion coefficient corrections
+// (D_hat) that make the coarse mesh diffusion equation reproduce the transport
+// currents exactly:
+//
+//   J(I->N) = D_tilde * (phi_I - phi_N) + D_hat * (phi_I + phi_N)
+//
+// The solution of the resulting low order eigenvalue problem is used to rescale
+// the fine mesh scalar flux (and the rays' angular fluxes) of each coarse cell
+// and group, and to replace k-eff. This propagates global changes in the
+// fission source shape across the core within a few iterations, which plain
+// power iteration would take hundreds of iterations to do.
+//
+// The low order problem is only partially converged in each iteration (at most
+// CMFD_MAX_OUTER_ITERATIONS power iterations). As it starts from the transport
+// flux, which was rescaled by the previous iteration's CMFD solution, the
+// coarse mesh solve effectively continues to converge over the inactive
+// iterations, at a small fraction of the cost of a full solve each iteration.
+//
+// Coarse cells larger than a pin (e.g., whole assemblies) are not supported.
+// Rays persist between iterations, and with ray lengths that are short compared
+// to an assembly, much of each assembly's neutron balance is carried by the
+// angular flux of rays starting and ending the iteration inside it rather than
+// by its surface currents, which makes the coarse mesh iteration unstable.
+//
+// All quantities are in the code's normalized units, where the total problem
+// area is 1 (i.e., the volume of each cell is 1 / n_cells). Tallied currents
+// are therefore normalized by the total track length, in the same way as the
+// scalar flux tallies, and the diffusion coefficients are divided by the
+// squared problem width.
+
+#define CMFD_MAX_OUTER_ITERATIONS 20
+#define CMFD_INNER_ITERATIONS 4
+#define CMFD_K_EFF_TOLERANCE 1.0e-6
+#define CMFD_SOURCE_TOLERANCE 1.0e-5
+
+CMFDData initialize_cmfd_data(Parameters P)
+{
+  CMFDData CMFD;
+  memset(&CMFD, 0, sizeof(CMFDData));
+  if( P.cmfd_type == NO_CMFD )
+    return CMFD;
+
+  CMFD.n_cells_per_dimension = P.n_cmfd_cells_per_dimension;
+  CMFD.cells_per_coarse_cell = P.n_cells_per_dimension / P.n_cmfd_cells_per_dimension;
+  uint64_t n_coarse = (uint64_t) CMFD.n_cells_per_dimension * CMFD.n_cells_per_dimension;
+  uint64_t G = P.n_energy_groups;
+
+  // Coarse cell containing each fine cell (coarse cells are numbered in row-major order)
+  CMFD.coarse_cell_id = (int *) malloc(P.n_cells * sizeof(int));
+  for( int y = 0; y < P.n_cells_per_dimension; y++ )
+    for( int x = 0; x < P.n_cells_per_dimension; x++ )
+      CMFD.coarse_cell_id[get_cell_id(P, x, y)] = (y / CMFD.cells_per_coarse_cell) * CMFD.n_cells_per_dimension + x / CMFD.cells_per_coarse_cell;
+
+  CMFD.current_x       = (float *)  calloc(n_coarse * G, sizeof(float));
+  CMFD.current_y       = (float *)  calloc(n_coarse * G, sizeof(float));
+  CMFD.leakage         = (float *)  calloc(n_coarse * G, sizeof(float));
+  CMFD.flux            = (double *) calloc(n_coarse * G, sizeof(double));
+  CMFD.cmfd_flux       = (double *) calloc(n_coarse * G, sizeof(double));
+  CMFD.Sigma_t         = (double *) calloc(n_coarse * G, sizeof(double));
+  CMFD.nu_Sigma_f      = (double *) calloc(n_coarse * G, sizeof(double));
+  CMFD.Chi             = (double *) calloc(n_coarse * G, sizeof(double));
+  CMFD.Sigma_s         = (double *) calloc(n_coarse * G * G, sizeof(double));
+  CMFD.D_tilde_x       = (double *) calloc(n_coarse * G, sizeof(double));
+  CMFD.D_tilde_y       = (double *) calloc(n_coarse * G, sizeof(double));
+  CMFD.D_hat_x         = (double *) calloc(n_coarse * G, sizeof(double));
+  CMFD.D_hat_y         = (double *) calloc(n_coarse * G, sizeof(double));
+  CMFD.D_hat_boundary  = (double *) calloc(n_coarse * G, sizeof(double));
+  CMFD.fission_source  = (double *) calloc(n_coarse, sizeof(double));
+
+  return CMFD;
+}
+
+void free_cmfd_data(CMFDData CMFD)
+{
+  free(CMFD.coarse_cell_id);
+  free(CMFD.current_x);
+  free(CMFD.current_y);
+  free(CMFD.leakage);
+  free(CMFD.flux);
+  free(CMFD.cmfd_flux);
+  free(CMFD.Sigma_t);
+  free(CMFD.nu_Sigma_f);
+  free(CMFD.Chi);
+  free(CMFD.Sigma_s);
+  free(CMFD.D_tilde_x);
+  free(CMFD.D_tilde_y);
+  free(CMFD.D_hat_x);
+  free(CMFD.D_hat_y);
+  free(CMFD.D_hat_boundary);
+  free(CMFD.fission_source);
+}
+
+size_t cmfd_memory_usage(Parameters P)
+{
+  if( P.cmfd_type == NO_CMFD )
+    return 0;
+  size_t n_coarse = (size_t) P.n_cmfd_cells_per_dimension * P.n_cmfd_cells_per_dimension;
+  size_t G = P.n_energy_groups;
+  size_t sz = P.n_cells * sizeof(int);
+  sz += n_coarse * G * 3 * sizeof(float);
+  sz += n_coarse * G * (10 + G) * sizeof(double);
+  sz += n_coarse * sizeof(double);
+  return sz;
+}
+
+void reset_cmfd_tallies(Parameters P, CMFDData * CMFD)
+{
+  size_t sz = (size_t) CMFD->n_cells_per_dimension * CMFD->n_cells_per_dimension * P.n_energy_groups * sizeof(float);
+  memset(CMFD->current_x, 0, sz);
+  memset(CMFD->current_y, 0, sz);
+  memset(CMFD->leakage,   0, sz);
+}
+
+// Computes the volume averaged scalar flux and the flux weighted cross sections of each coarse cell
+void homogenize_cmfd_cross_sections(Parameters P, SimulationData SD, CMFDData * CMFD)
+{
+  int G = P.n_energy_groups;
+  int width = CMFD->cells_per_coarse_cell;
+  int n_coarse = CMFD->n_cells_per_dimension * CMFD->n_cells_per_dimension;
+  ReadOnlyData ROD = SD.readOnlyData;
+  const float * scalar_flux = SD.readWriteData.cellData.new_scalar_flux;
+
+  #pragma omp parallel for schedule(dynamic)
+  for( int coarse_cell = 0; coarse_cell < n_coarse; coarse_cell++ )
+  {
+    int x0 = (coarse_cell % CMFD->n_cells_per_dimension) * width;
+    int y0 = (coarse_cell / CMFD->n_cells_per_dimension) * width;
+
+    double flux_sum[G];
+    double Sigma_t_sum[G];
+    double nu_Sigma_f_sum[G];
+    double Chi_sum[G];
+    double Sigma_s_sum[G * G];
+    double fission_sum = 0.0;
+    memset(flux_sum,       0, sizeof(flux_sum));
+    memset(Sigma_t_sum,    0, sizeof(Sigma_t_sum));
+    memset(nu_Sigma_f_sum, 0, sizeof(nu_Sigma_f_sum));
+    memset(Chi_sum,        0, sizeof(Chi_sum));
+    memset(Sigma_s_sum,    0, sizeof(Sigma_s_sum));
+
+    for( int y = y0; y < y0 + width; y++ )
+    {
+      for( int x = x0; x < x0 + width; x++ )
+      {
+        int cell = get_cell_id(P, x, y);
+        int XS_base = ROD.material_id[cell] * G;
+        const float * phi = scalar_flux + (uint64_t) cell * G;
+
+        double fission = 0.0;
+        for( int g = 0; g < G; g++ )
+        {
+          flux_sum[g]       += phi[g];
+          Sigma_t_sum[g]    += ROD.Sigma_t[XS_base + g] * phi[g];
+          nu_Sigma_f_sum[g] += ROD.nu_Sigma_f[XS_base + g] * phi[g];
+          fission           += ROD.nu_Sigma_f[XS_base + g] * phi[g];
+
+          // Scattering from group g_in into group g
+          for( int g_in = 0; g_in < G; g_in++ )
+            Sigma_s_sum[g * G + g_in] += ROD.Sigma_s[(XS_base + g) * G + g_in] * phi[g_in];
+        }
+        for( int g = 0; g < G; g++ )
+          Chi_sum[g] += ROD.Chi[XS_base + g] * fission;
+        fission_sum += fission;
+      }
+    }
+
+    uint64_t idx = (uint64_t) coarse_cell * G;
+    for( int g = 0; g < G; g++ )
+    {
+      double inverse_flux = (flux_sum[g] > 0.0) ? 1.0 / flux_sum[g] : 0.0;
+      CMFD->flux[idx + g]       = flux_sum[g] / (width * width);
+      CMFD->Sigma_t[idx + g]    = Sigma_t_sum[g] * inverse_flux;
+      CMFD->nu_Sigma_f[idx + g] = nu_Sigma_f_sum[g] * inverse_flux;
+      CMFD->Chi[idx + g]        = (fission_sum > 0.0) ? Chi_sum[g] / fission_sum : 0.0;
+      for( int g_in = 0; g_in < G; g_in++ )
+      {
+        double inverse_flux_in = (flux_sum[g_in] > 0.0) ? 1.0 / flux_sum[g_in] : 0.0;
+        CMFD->Sigma_s[(idx + g) * G + g_in] = Sigma_s_sum[g * G + g_in] * inverse_flux_in;
+      }
+    }
+  }
+}
+
+// Computes the coupling coefficients of a surface between coarse cells I and N.
+// If the correction term is larger than the diffusion coupling term, the matrix
+// can lose positivity, so both terms are instead chosen such that the current is
+// carried entirely by the flux of the upwind cell.
+void compute_surface_coupling(double D_I, double D_N, double phi_I, double phi_N, double current, double inverse_width_squared, double * D_tilde, double * D_hat)
+{
+  *D_tilde = 2.0 * D_I * D_N / (D_I + D_N) * inverse_width_squared;
+  *D_hat = (current - *D_tilde * (phi_I - phi_N)) / (phi_I + phi_N);
+
+  if( fabs(*D_hat) > *D_tilde )
+  {
+    if( current > 0.0 )
+    {
+      *D_tilde = current / (2.0 * phi_I);
+      *D_hat = *D_tilde;
+    }
+    else
+    {
+      *D_tilde = -current / (2.0 * phi_N);
+      *D_hat = -*D_tilde;
+    }
+  }
+}
+
+void compute_cmfd_coupling(Parameters P, CMFDData * CMFD)
+{
+  int G = P.n_energy_groups;
+  int N = CMFD->n_cells_per_dimension;
+  double inverse_width_squared = P.inverse_length_per_dimension * P.inverse_length_per_dimension;
+
+  #pragma omp parallel for
+  for( int coarse_cell = 0; coarse_cell < N * N; coarse_cell++ )
+  {
+    int cx = coarse_cell % N;
+    int cy = coarse_cell / N;
+    for( int g = 0; g < G; g++ )
+    {
+      uint64_t idx = (uint64_t) coarse_cell * G + g;
+      CMFD->D_tilde_x[idx] = CMFD->D_hat_x[idx] = 0.0;
+      CMFD->D_tilde_y[idx] = CMFD->D_hat_y[idx] = 0.0;
+      CMFD->D_hat_boundary[idx] = 0.0;
+
+      // Poorly tracked cells can have a zero (or negative) flux estimate in early
+      // iterations, in which case they are left uncoupled
+      double phi_I = CMFD->flux[idx];
+      if( phi_I <= 0.0 )
+        continue;
+      double D_I = 1.0 / (3.0 * CMFD->Sigma_t[idx]);
+
+      if( cx < N - 1 )
+      {
+        uint64_t n_idx = idx + G;
+        if( CMFD->flux[n_idx] > 0.0 )
+          compute_surface_coupling(D_I, 1.0 / (3.0 * CMFD->Sigma_t[n_idx]), phi_I, CMFD->flux[n_idx],
+              CMFD->current_x[idx] * P.inverse_total_track_length, inverse_width_squared, &CMFD->D_tilde_x[idx], &CMFD->D_hat_x[idx]);
+      }
+
+      if( cy < N - 1 )
+      {
+        uint64_t n_idx = idx + (uint64_t) N * G;
+        if( CMFD->flux[n_idx] > 0.0 )
+          compute_surface_coupling(D_I, 1.0 / (3.0 * CMFD->Sigma_t[n_idx]), phi_I, CMFD->flux[n_idx],
+              CMFD->current_y[idx] * P.inverse_total_track_length, inverse_width_squared, &CMFD->D_tilde_y[idx], &CMFD->D_hat_y[idx]);
+      }
+
+      // Leakage through vacuum boundaries is carried entirely by the correction term
+      CMFD->D_hat_boundary[idx] = CMFD->leakage[idx] * P.inverse_total_track_length / phi_I;
+    }
+  }
+}
+
+double compute_cmfd_fission_source(Parameters P, CMFDData * CMFD, double volume)
+{
+  int G = P.n_energy_groups;
+  int n_coarse = CMFD->n_cells_per_dimension * CMFD->n_cells_per_dimension;
+  double total = 0.0;
+  for( int coarse_cell = 0; coarse_cell < n_coarse; coarse_cell++ )
+  {
+    double fission = 0.0;
+    for( int g = 0; g < G; g++ )
+      fission += CMFD->nu_Sigma_f[coarse_cell * G + g] * CMFD->cmfd_flux[coarse_cell * G + g];
+    CMFD->fission_source[coarse_cell] = fission * volume;
+    total += CMFD->fission_source[coarse_cell];
+  }
+  return total;
+}
+
+// Returns the diagonal of the coarse mesh diffusion matrix for a cell and group
+double get_cmfd_diagonal(CMFDData * CMFD, int coarse_cell, int g, int G, double volume)
+{
+  int N = CMFD->n_cells_per_dimension;
+  int cx = coarse_cell % N;
+  int cy = coarse_cell / N;
+  uint64_t idx = (uint64_t) coarse_cell * G + g;
+
+  double diagonal = (CMFD->Sigma_t[idx] - CMFD->Sigma_s[idx * G + g]) * volume + CMFD->D_hat_boundary[idx];
+
+  // The -x and -y surfaces are stored by the neighbor
+  if( cx < N - 1 )
+    diagonal += CMFD->D_tilde_x[idx] + CMFD->D_hat_x[idx];
+  if( cx > 0 )
+    diagonal += CMFD->D_tilde_x[idx - G] - CMFD->D_hat_x[idx - G];
+  if( cy < N - 1 )
+    diagonal += CMFD->D_tilde_y[idx] + CMFD->D_hat_y[idx];
+  if( cy > 0 )
+    diagonal += CMFD->D_tilde_y[idx - (uint64_t) N * G] - CMFD->D_hat_y[idx - (uint64_t) N * G];
+
+  return diagonal;
+}
+
+// Solves the coarse mesh diffusion eigenvalue problem by power iteration. The
+// groups are solved in turn (Gauss-Seidel in energy), each with a few sweeps
+// of SOR over the coarse cells.
+double solve_cmfd_eigenproblem(Parameters P, CMFDData * CMFD, double k_eff)
+{
+  int G = P.n_energy_groups;
+  int N = CMFD->n_cells_per_dimension;
+  int n_coarse = N * N;
+  double volume = CMFD->cells_per_coarse_cell * CMFD->cells_per_coarse_cell * P.cell_volume;
+  double * phi = CMFD->cmfd_flux;
+
+  memcpy(phi, CMFD->flux, n_coarse * G * sizeof(double));
+  double total_fission = compute_cmfd_fission_source(P, CMFD, volume);
+  double * old_fission_source = (double *) malloc(n_coarse * sizeof(double));
+  double * group_source = (double *) malloc(n_coarse * sizeof(double));
+  double * diagonal = (double *) malloc((uint64_t) n_coarse * G * sizeof(double));
+
+  for( int coarse_cell = 0; coarse_cell < n_coarse; coarse_cell++ )
+    for( int g = 0; g < G; g++ )
+      diagonal[coarse_cell * G + g] = get_cmfd_diagonal(CMFD, coarse_cell, g, G, volume);
+
+  for( int iter = 0; iter < CMFD_MAX_OUTER_ITERATIONS; iter++ )
+  {
+    memcpy(old_fission_source, CMFD->fission_source, n_coarse * sizeof(double));
+
+    for( int g = 0; g < G; g++ )
+    {
+      // Fission and in-scattering sources
+      for( int coarse_cell = 0; coarse_cell < n_coarse; coarse_cell++ )
+      {
+        uint64_t idx = (uint64_t) coarse_cell * G + g;
+        const double * Sigma_s = CMFD->Sigma_s + idx * G;
+        double source = CMFD->Chi[idx] * old_fission_source[coarse_cell] / k_eff;
+        for( int g_in = 0; g_in < G; g_in++ )
+          if( g_in != g )
+            source += Sigma_s[g_in] * phi[coarse_cell * G + g_in] * volume;
+        group_source[coarse_cell] = source;
+      }
+
+      for( int inner = 0; inner < CMFD_INNER_ITERATIONS; inner++ )
+      {
+        for( int coarse_cell = 0; coarse_cell < n_coarse; coarse_cell++ )
+        {
+          uint64_t idx = (uint64_t) coarse_cell * G + g;
+          if( diagonal[idx] <= 0.0 )
+            continue;
+
+          int cx = coarse_cell % N;
+          int cy = coarse_cell / N;
+          double source = group_source[coarse_cell];
+
+          // Neighbor couplings (the -x and -y surfaces are stored by the neighbor)
+          if( cx < N - 1 )
+            source -= (CMFD->D_hat_x[idx] - CMFD->D_tilde_x[idx]) * phi[idx + G];
+          if( cx > 0 )
+          {
+            uint64_t n_idx = idx - G;
+            source += (CMFD->D_tilde_x[n_idx] + CMFD->D_hat_x[n_idx]) * phi[n_idx];
+          }
+          if( cy < N - 1 )
+            source -= (CMFD->D_hat_y[idx] - CMFD->D_tilde_y[idx]) * phi[idx + (uint64_t) N * G];
+          if( cy > 0 )
+          {
+            uint64_t n_idx = idx - (uint64_t) N * G;
+            source += (CMFD->D_tilde_y[n_idx] + CMFD->D_hat_y[n_idx]) * phi[n_idx];
+          }
+
+          phi[idx] = source / diagonal[idx];
+        }
+      }
+    }
+
+    // Update the eigenvalue, and check the convergence of the eigenvalue and fission source
+    double new_total_fission = compute_cmfd_fission_source(P, CMFD, volume);
+    double new_k_eff = k_eff * new_total_fission / total_fission;
+
+    double residual = 0.0;
+    double norm = 0.0;
+    for( int coarse_cell = 0; coarse_cell < n_coarse; coarse_cell++ )
+    {
+      double difference = CMFD->fission_source[coarse_cell] / new_total_fission - old_fission_source[coarse_cell] / total_fission;
+      residual += difference * difference;
+      norm += (old_fission_source[coarse_cell] / total_fission) * (old_fission_source[coarse_cell] / total_fission);
+    }
+
+    int is_converged = fabs(new_k_eff - k_eff) < CMFD_K_EFF_TOLERANCE && residual < CMFD_SOURCE_TOLERANCE * CMFD_SOURCE_TOLERANCE * norm;
+    k_eff = new_k_eff;
+    total_fission = new_total_fission;
+    if( !isfinite(k_eff) )
+      break;
+    if( is_converged )
+      break;
+  }
+
+  free(old_fission_source);
+  free(group_source);
+  free(diagonal);
+
+  return k_eff;
+}
+
+// Rescales the fine mesh scalar flux, and the angular flux of each ray, by the
+// ratio of the CMFD flux to the transport flux of the coarse cell they lie in.
+// The CMFD flux is normalized to preserve the transport fission source.
+void prolong_cmfd_flux(Parameters P, SimulationData SD, CMFDData * CMFD)
+{
+  int G = P.n_energy_groups;
+  int n_coarse = CMFD->n_cells_per_dimension * CMFD->n_cells_per_dimension;
+
+  double cmfd_fission = 0.0;
+  double transport_fission = 0.0;
+  for( uint64_t i = 0; i < (uint64_t) n_coarse * G; i++ )
+  {
+    cmfd_fission      += CMFD->nu_Sigma_f[i] * CMFD->cmfd_flux[i];
+    transport_fission += CMFD->nu_Sigma_f[i] * CMFD->flux[i];
+  }
+  double normalization = transport_fission / cmfd_fission;
+
+  // The CMFD flux array is overwritten with the scaling factors
+  double * factor = CMFD->cmfd_flux;
+  for( uint64_t i = 0; i < (uint64_t) n_coarse * G; i++ )
+    factor[i] = (CMFD->flux[i] > 0.0 && factor[i] > 0.0) ? normalization * factor[i] / CMFD->flux[i] : 1.0;
+
+  float * scalar_flux = SD.readWriteData.cellData.new_scalar_flux;
+  float * flux_gradient = SD.readWriteData.cellData.new_flux_gradient;
+  #pragma omp parallel for
+  for( int cell = 0; cell < P.n_cells; cell++ )
+  {
+    const double * f = factor + (uint64_t) CMFD->coarse_cell_id[cell] * G;
+    for( int g = 0; g < G; g++ )
+      scalar_flux[(uint64_t) cell * G + g] *= f[g];
+    // The linear source flux gradients are scaled along with the flux
+    if( flux_gradient != NULL )
+      for( int g = 0; g < G; g++ )
+      {
+        flux_gradient[(uint64_t) cell * P.n_flux_gradient_entries + g * 2]     *= f[g];
+        flux_gradient[(uint64_t) cell * P.n_flux_gradient_entries + g * 2 + 1] *= f[g];
+      }
+  }
+
+  RayData RD = SD.readWriteData.rayData;
+  #pragma omp parallel for
+  for( int ray = 0; ray < P.n_rays; ray++ )
+  {
+    const double * f = factor + (uint64_t) CMFD->coarse_cell_id[RD.cell_id[ray]] * G;
+    for( int g = 0; g < G; g++ )
+      RD.angular_flux[(uint64_t) ray * G + g] *= f[g];
+  }
+}
+
+// Applies CMFD acceleration to this iteration's scalar flux, returning the CMFD eigenvalue
+double cmfd_accelerate(Parameters P, SimulationData SD, double k_eff)
+{
+  CMFDData * CMFD = &SD.readWriteData.cmfdData;
+  homogenize_cmfd_cross_sections(P, SD, CMFD);
+  compute_cmfd_coupling(P, CMFD);
+  double cmfd_k_eff = solve_cmfd_eigenproblem(P, CMFD, k_eff);
+
+  // A noisy early iteration can (rarely) give a coarse mesh problem with no
+  // physical solution, in which case the transport solution is left unchanged
+  if( !isfinite(cmfd_k_eff) || cmfd_k_eff <= 0.0 )
+    return k_eff;
+
+  prolong_cmfd_flux(P, SD, CMFD);
+  return cmfd_k_eff;
+}
@@ -0,0 +1,58 @@
+// CMFD current tally helper shared by the flux attenuation kernels. Each time a
+// ray moves from one segment to the next, the angular flux leaving the first
+// segment is tallied to the coarse mesh surface the ray crossed (if any). Net
+// currents are stored per coarse cell for its +x and +y surfaces, so a crossing
+// in the negative direction is subtracted from the neighbor's surface. Segments
+// flagged with a vacuum reflection mark the ray leaving the problem, so the
+// outgoing angular flux is tallied to the coarse cell's boundary leakage.
+//
+// The angular flux of rays starting and ending the iteration inside a coarse
+// cell is not tallied. These terms cancel on average once the source has
+// converged, but including them makes the leakage of lightly tracked cells
+// negative, which can make the coarse mesh diffusion problem unstable.
+//
+// A from_cell_id of -1 marks the first segment of a ray (so nothing is tallied).
+// The angular_flux array holds n_groups groups, starting at first_group.
+
+static inline void tally_cmfd_current(Parameters P, SimulationData SD, int from_cell_id, int to_cell_id, int did_vacuum_reflect, const float * angular_flux, int first_group, int n_groups)
+{
+  CMFDData * CMFD = &SD.readWriteData.cmfdData;
+  if( !CMFD->is_tallying || from_cell_id < 0 )
+    return;
+
+  int from = CMFD->coarse_cell_id[from_cell_id];
+  float * tally;
+  float sign = 1.0f;
+
+  if( did_vacuum_reflect )
+    tally = CMFD->leakage + from * P.n_energy_groups;
+  else
+  {
+    int to = CMFD->coarse_cell_id[to_cell_id];
+    if( to == from )
+      return;
+
+    if( to == from + 1 )
+      tally = CMFD->current_x + from * P.n_energy_groups;
+    else if( to == from - 1 )
+    {
+      tally = CMFD->current_x + to * P.n_energy_groups;
+      sign = -1.0f;
+    }
+    else if( to == from + CMFD->n_cells_per_dimension )
+      tally = CMFD->current_y + from * P.n_energy_groups;
+    else if( to == from - CMFD->n_cells_per_dimension )
+    {
+      tally = CMFD->current_y + to * P.n_energy_groups;
+      sign = -1.0f;
+    }
+    else
+      return; // Diagonal (corner) crossings are not tallied
+  }
+
+  for( int energy_group = 0; energy_group < n_groups; energy_group++ )
+  {
+    #pragma omp atomic
+    tally[first_group + energy_group] += sign * angular_flux[energy_group];
+  }
+}
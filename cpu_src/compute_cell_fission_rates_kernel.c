@@ -1,22 +1,38 @@
 #include "minray.h"
+#include "group_specialization.h"
 
-void compute_cell_fission_rates_kernel(Parameters P, SimulationData SD, float * scalar_flux, int cell)
+SPECIALIZED_INLINE void compute_cell_fission_rate(Parameters P, SimulationData SD, const int G, const float * scalar_flux, int cell)
 {
-  if( cell >= P.n_cells )
+  int material_id = SD.readOnlyData.material_id[cell];
+
+  // Non-fissile materials have no fission rate to sum
+  if( !SD.readOnlyData.is_fissile[material_id] )
+  {
+    SD.readWriteData.cellData.fission_rate[cell] = 0.0f;
     return;
+  }
 
-  int material_id = SD.readOnlyData.material_id[cell];
-  int XS_idx      = material_id * P.n_energy_groups;
-  float * nu_Sigma_f = SD.readOnlyData.nu_Sigma_f + XS_idx;
+  int XS_idx      = material_id * G;
+  const float * nu_Sigma_f = SD.readOnlyData.nu_Sigma_f + XS_idx;
 
-  uint64_t flux_idx = (uint64_t) cell * P.n_energy_groups;
+  uint64_t flux_idx = (uint64_t) cell * G;
   scalar_flux += flux_idx;
 
   double fission_rate = 0.0;
-  for( int energy_group = 0; energy_group < P.n_energy_groups; energy_group++ )
+  for( int energy_group = 0; energy_group < G; energy_group++ )
   {
     fission_rate += nu_Sigma_f[energy_group] * scalar_flux[energy_group];
   }
 
   SD.readWriteData.cellData.fission_rate[cell] = fission_rate * P.cell_volume;
 }
+
+void compute_cell_fission_rates_kernel(Parameters P, SimulationData SD, float * scalar_flux, int cell)
+{
+  if( cell >= P.n_cells )
+    return;
+
+  #define COMPUTE_CELL_FISSION_RATE(G) compute_cell_fission_rate(P, SD, G, scalar_flux, cell)
+  SPECIALIZE_ON_GROUP_COUNT(P, COMPUTE_CELL_FISSION_RATE);
+  #undef COMPUTE_CELL_FISSION_RATE
+}
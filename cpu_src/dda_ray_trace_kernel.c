@@ -0,0 +1,100 @@
+#include "minray.h"
+#include "cell_order.h"
+
+// Incremental (Amanatides-Woo style) traversal of the Cartesian mesh. Rather
+// than intersecting the ray with all four surfaces of each cell and locating
+// the neighbor cell with a floating point lookup, the distance to the next x
+// and y surface crossings is precomputed once per ray, and the ray is then
+// stepped across the mesh by integer cell indices. Reflections at the outer
+// boundaries are handled by flipping the step direction, so no BUMP nudging
+// of the ray location is required.
+
+void initialize_dda_state(Parameters P, RayState * ray)
+{
+  ray->step_x = (ray->x_dir > 0.0) ? 1 : -1;
+  ray->step_y = (ray->y_dir > 0.0) ? 1 : -1;
+
+  // Distance travelled along the ray between two consecutive surface crossings in each dimension
+  ray->t_delta_x = (ray->x_dir != 0.0) ? P.cell_width / fabs(ray->x_dir) : INFINITY;
+  ray->t_delta_y = (ray->y_dir != 0.0) ? P.cell_width / fabs(ray->y_dir) : INFINITY;
+
+  // Distance along the ray to the first surface crossing in each dimension
+  double x_surface = (ray->x_idx + (ray->step_x > 0)) * P.cell_width;
+  double y_surface = (ray->y_idx + (ray->step_y > 0)) * P.cell_width;
+  ray->t_max_x = (ray->x_dir != 0.0) ? fmax((x_surface - ray->x) / ray->x_dir, 0.0) : INFINITY;
+  ray->t_max_y = (ray->y_dir != 0.0) ? fmax((y_surface - ray->y) / ray->y_dir, 0.0) : INFINITY;
+}
+
+Segment dda_trace_segment(Parameters P, RayState * ray)
+{
+  // Determine which surface is crossed next
+  int is_x_crossing = ray->t_max_x < ray->t_max_y;
+  double t_crossing = is_x_crossing ? ray->t_max_x : ray->t_max_y;
+
+  Segment segment;
+  segment.cell_id = ray->cell_id;
+  segment.did_vacuum_reflect = ray->just_hit_vacuum;
+  ray->just_hit_vacuum = 0;
+
+  // Check to see if ray has reached its maximum distance. Truncate if needed
+  if( t_crossing >= P.distance_per_ray )
+  {
+    segment.distance = P.distance_per_ray - ray->distance_travelled;
+    ray->x += ray->x_dir * segment.distance;
+    ray->y += ray->y_dir * segment.distance;
+    ray->distance_travelled = P.distance_per_ray;
+    ray->is_terminal = 1;
+    return segment;
+  }
+
+  segment.distance = t_crossing - ray->distance_travelled;
+  ray->distance_travelled = t_crossing;
+
+  if( is_x_crossing )
+  {
+    // Place the ray exactly on the surface being crossed
+    ray->x = (ray->x_idx + (ray->step_x > 0)) * P.cell_width;
+    ray->y += ray->y_dir * segment.distance;
+    ray->t_max_x += ray->t_delta_x;
+
+    int next_x_idx = ray->x_idx + ray->step_x;
+    if( next_x_idx < 0 || next_x_idx >= P.n_cells_per_dimension )
+    {
+      // The ray stays in the same cell but travels back in the other direction
+      int boundary_condition = P.boundary_conditions[(next_x_idx < 0) ? 0 : 2][1];
+      if( boundary_condition == VACUUM )
+        ray->just_hit_vacuum = 1;
+      ray->step_x = -ray->step_x;
+      ray->x_dir  = -ray->x_dir;
+    }
+    else
+      ray->x_idx = next_x_idx;
+  }
+  else
+  {
+    // Place the ray exactly on the surface being crossed
+    ray->x += ray->x_dir * segment.distance;
+    ray->y = (ray->y_idx + (ray->step_y > 0)) * P.cell_width;
+    ray->t_max_y += ray->t_delta_y;
+
+    int next_y_idx = ray->y_idx + ray->step_y;
+    if( next_y_idx < 0 || next_y_idx >= P.n_cells_per_dimension )
+    {
+      // The ray stays in the same cell but travels back in the other direction
+      int boundary_condition = P.boundary_conditions[1][(next_y_idx < 0) ? 0 : 2];
+      if( boundary_condition == VACUUM )
+        ray->just_hit_vacuum = 1;
+      ray->step_y = -ray->step_y;
+      ray->y_dir  = -ray->y_dir;
+    }
+    else
+      ray->y_idx = next_y_idx;
+  }
+
+  ray->cell_id = get_cell_id(P, ray->x_idx, ray->y_idx);
+
+  // Some sanity checks (can be disabled if desired)
+  assert(ray->cell_id >= 0 && ray->cell_id < P.n_cells);
+
+  return segment;
+}
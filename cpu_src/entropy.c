@@ -0,0 +1,92 @@
+#include "minray.h"
+#include "cell_order.h"
+
+// Shannon entropy of the fission source, used to judge when the inactive
+// iterations have converged. The fission rates are binned onto a coarse mesh
+// of ENTROPY_MESH_DIMENSION x ENTROPY_MESH_DIMENSION bins (3 x 3 pin cells
+// each for the C5G7 core, independent of the problem size multiplier), and
+// H = -sum(p * log2(p)) is computed from each bin's fraction p of the total.
+// As the source shape converges, H settles to a (noisy) plateau, which is
+// often reached later than the plateau in k-eff.
+
+// Computes the entropy of the fission rates currently held in the fission_rate
+// array (i.e., those of the new scalar flux, as left by compute_k_eff).
+double compute_shannon_entropy(Parameters P, SimulationData SD)
+{
+  float * fission_rate = SD.readWriteData.cellData.fission_rate;
+  int cells_per_bin = P.n_cells_per_dimension / ENTROPY_MESH_DIMENSION;
+  double bin_fission_rate[ENTROPY_MESH_DIMENSION * ENTROPY_MESH_DIMENSION];
+
+  #pragma omp parallel for
+  for( int bin = 0; bin < ENTROPY_MESH_DIMENSION * ENTROPY_MESH_DIMENSION; bin++ )
+  {
+    int x_start = (bin % ENTROPY_MESH_DIMENSION) * cells_per_bin;
+    int y_start = (bin / ENTROPY_MESH_DIMENSION) * cells_per_bin;
+    double sum = 0.0;
+    for( int y = y_start; y < y_start + cells_per_bin; y++ )
+      for( int x = x_start; x < x_start + cells_per_bin; x++ )
+        sum += fission_rate[get_cell_id(P, x, y)];
+    bin_fission_rate[bin] = sum;
+  }
+
+  double total_fission_rate = 0.0;
+  for( int bin = 0; bin < ENTROPY_MESH_DIMENSION * ENTROPY_MESH_DIMENSION; bin++ )
+    total_fission_rate += bin_fission_rate[bin];
+
+  double entropy = 0.0;
+  for( int bin = 0; bin < ENTROPY_MESH_DIMENSION * ENTROPY_MESH_DIMENSION; bin++ )
+  {
+    double p = bin_fission_rate[bin] / total_fission_rate;
+    if( p > 0.0 )
+      entropy -= p * log2(p);
+  }
+
+  return entropy;
+}
+
+// Tests whether the last ENTROPY_WINDOW values of a history show no trend. The
+// iteration to iteration noise is estimated from the successive differences
+// (which are insensitive to a slow trend), and the values are taken to be
+// stationary if both the shift in the mean between the two halves of the window
+// is within two standard deviations of what the noise alone would give, and the
+// variance over the whole window is no more than twice that of the noise. The
+// first test catches slow drifts, and the second the fast transient of the
+// first few iterations.
+int is_window_stationary(double * history, int n)
+{
+  double * window = history + n - ENTROPY_WINDOW;
+  int half = ENTROPY_WINDOW / 2;
+
+  double first_half_sum = 0.0;
+  double second_half_sum = 0.0;
+  for( int i = 0; i < half; i++ )
+  {
+    first_half_sum += window[i];
+    second_half_sum += window[half + i];
+  }
+  double mean = (first_half_sum + second_half_sum) / ENTROPY_WINDOW;
+
+  double sum_of_squares = 0.0;
+  double sum_of_squared_differences = 0.0;
+  for( int i = 0; i < ENTROPY_WINDOW; i++ )
+  {
+    sum_of_squares += (window[i] - mean) * (window[i] - mean);
+    if( i > 0 )
+      sum_of_squared_differences += (window[i] - window[i-1]) * (window[i] - window[i-1]);
+  }
+  double variance = sum_of_squares / (ENTROPY_WINDOW - 1);
+  double noise_variance = sum_of_squared_differences / (2.0 * (ENTROPY_WINDOW - 1));
+
+  double drift = fabs(second_half_sum - first_half_sum) / half;
+  return drift * drift <= 4.0 * noise_variance * 2.0 / half && variance <= 2.0 * noise_variance;
+}
+
+// The source is considered converged once neither the entropy nor k-eff show a
+// trend over the last ENTROPY_WINDOW iterations. The history arrays hold n iterations.
+int has_source_converged(double * entropy_history, double * k_eff_history, int n)
+{
+  if( n < ENTROPY_WINDOW )
+    return 0;
+
+  return is_window_stationary(entropy_history, n) && is_window_stationary(k_eff_history, n);
+}
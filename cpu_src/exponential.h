@@ -0,0 +1,73 @@
+// Rational approximation of ( 1 - exp( -tau ) ) used by the flux attenuation
+// kernels. It is kept here so that all transport sweep variants share the same
+// arithmetic, and is declared inline so that it can be vectorized in place.
+//
+// Intrinsic version:
+// float exponential = -expm1(-tau);
+static inline float exponential_approximation(float tau)
+{
+  const float c1n =-1.0000013559236386308f;
+  const float c2n = 0.23151368626911062025f;
+  const float c3n =-0.061481916409314966140f;
+  const float c4n = 0.0098619906458127653020f;
+  const float c5n =-0.0012629460503540849940f;
+  const float c6n = 0.00010360973791574984608f;
+  const float c7n =-0.000013276571933735820960f;
+
+  const float c0d = 1.0f;
+  const float c1d =-0.73151337729389001396f;
+  const float c2d = 0.26058381273536471371f;
+  const float c3d =-0.059892419041316836940f;
+  const float c4d = 0.0099070188241094279067f;
+  const float c5d =-0.0012623388962473160860f;
+  const float c6d = 0.00010361277635498731388f;
+  const float c7d =-0.000013276569500666698498f;
+
+  float x = -tau;
+  float num, den;
+
+  den = c7d;
+  den = den * x + c6d;
+  den = den * x + c5d;
+  den = den * x + c4d;
+  den = den * x + c3d;
+  den = den * x + c2d;
+  den = den * x + c1d;
+  den = den * x + c0d;
+
+  num = c7n;
+  num = num * x + c6n;
+  num = num * x + c5n;
+  num = num * x + c4n;
+  num = num * x + c3n;
+  num = num * x + c2n;
+  num = num * x + c1n;
+  num = num * x;
+
+  return num / den;
+}
+
+// Exponential terms of the linear source attenuation (see
+// linear_source.h), in double precision, given the exponential
+// ( 1 - exp( -tau ) ) of the segment:
+//
+//   G(tau)  = ( tau - ( 1 - exp( -tau ) ) ) / tau^2
+//   G2(tau) = 1/6 - 1/tau + ( 1 + 2/tau ) * ( 1 - ( 1 + tau ) * G(tau) )
+//
+// Both closed forms lose their precision to cancellation for thin segments, so
+// below LINEAR_SOURCE_SERIES_TAU their Taylor series are used instead.
+static inline double exponential_G(double tau, double exponential)
+{
+  if( tau < LINEAR_SOURCE_SERIES_TAU )
+    return 1.0/2.0 + tau * (-1.0/6.0 + tau * (1.0/24.0 + tau * (-1.0/120.0 + tau * (1.0/720.0))));
+
+  return (tau - exponential) / (tau * tau);
+}
+
+static inline double exponential_G2(double tau, double G)
+{
+  if( tau < LINEAR_SOURCE_SERIES_TAU )
+    return tau * (-1.0/12.0 + tau * (7.0/120.0 + tau * (-7.0/360.0 + tau * (23.0/5040.0))));
+
+  return 1.0/6.0 - 1.0/tau + (1.0 + 2.0/tau) * (1.0 - (1.0 + tau) * G);
+}
@@ -0,0 +1,45 @@
+// Vectorized flux attenuation across a single segment, shared by the two-phase
+// vector kernel and the fused sweep. Each is specialized on the energy group
+// count for a whole ray at a time (see group_specialization.h), so this is
+// inlined into every copy with G a compile-time constant.
+
+// Attenuates a ray's angular flux across a single segment in all energy groups
+// at once. Energy groups are padded to a multiple of SIMD_WIDTH, with the padded
+// lanes having a zero total cross section and source, so that the tau, exponential,
+// and angular flux updates are performed in full SIMD lanes with no remainder loop.
+// The angular_flux and source arrays must be n_energy_groups_padded long, and the
+// padded lanes of the source array must be zero.
+SPECIALIZED_INLINE void attenuate_segment_groups(Parameters P, SimulationData SD, const int G, int thread_id, float * restrict angular_flux, float * restrict source, uint64_t cell_id, float distance)
+{
+  const int G_padded = ((G + SIMD_WIDTH - 1) / SIMD_WIDTH) * SIMD_WIDTH;
+  float delta_psi[G_padded];
+
+  const float * Sigma_t = SD.readOnlyData.Sigma_t_padded + SD.readOnlyData.material_id[cell_id] * G_padded;
+  const float * isotropic_source = SD.readWriteData.cellData.isotropic_source + cell_id * G;
+
+  for( int energy_group = 0; energy_group < G; energy_group++ )
+    source[energy_group] = isotropic_source[energy_group];
+
+  for( int block = 0; block < G_padded; block += SIMD_WIDTH )
+  {
+    #pragma omp simd
+    for( int lane = 0; lane < SIMD_WIDTH; lane++ )
+    {
+      int energy_group = block + lane;
+
+      // tau calculation ( tau = Sigma_t * distance )
+      float tau = Sigma_t[energy_group] * distance;
+
+      // Exponential computation ( exponential = 1 - exp( -tau ) )
+      float exponential = exponential_approximation(tau);
+
+      delta_psi[energy_group] = (angular_flux[energy_group] - source[energy_group]) * exponential;
+      angular_flux[energy_group] -= delta_psi[energy_group];
+    }
+  }
+
+  // Tally the change in angular flux to the cell's scalar flux
+  float * tally = get_scalar_flux_tally(P, SD, thread_id, cell_id);
+  for( int energy_group = 0; energy_group < G; energy_group++ )
+    tally_scalar_flux(P, tally + energy_group, delta_psi[energy_group]);
+}
@@ -0,0 +1,62 @@
+#include "minray.h"
+#include "exponential.h"
+#include "tally.h"
+#include "segment_store.h"
+#include "cmfd.h"
+#include "group_specialization.h"
+#include "flux_attenuation.h"
+
+// Attenuates a ray's angular flux across all of its stored segments
+SPECIALIZED_INLINE void attenuate_ray_groups(Parameters P, SimulationData SD, const int G, uint64_t ray_id)
+{
+  const int G_padded = ((G + SIMD_WIDTH - 1) / SIMD_WIDTH) * SIMD_WIDTH;
+
+  // Indexing
+  float * ray_angular_flux  = SD.readWriteData.rayData.angular_flux + ray_id * G;
+
+  IntersectionData ID       = SD.readWriteData.intersectionData;
+  int n_intersections       = ID.n_intersections[ray_id];
+  uint64_t segment_offset   = get_ray_segment_offset(P, ID, ray_id);
+  int thread_id             = get_thread_num();
+  int previous_cell_id      = -1;
+
+  // Load the ray's angular flux into padded SIMD lanes
+  float angular_flux[G_padded];
+  float source[G_padded];
+  for( int energy_group = 0; energy_group < G_padded; energy_group++ )
+  {
+    angular_flux[energy_group] = (energy_group < G) ? ray_angular_flux[energy_group] : 0.0f;
+    source[energy_group] = 0.0f;
+  }
+
+  // Loop over all of this ray's intersections
+  for( int i = 0; i < n_intersections; i++ )
+  {
+    Segment segment = load_stored_segment(P, ID, segment_offset + i);
+
+    // Tally the angular flux crossing into this segment to the CMFD coarse mesh
+    tally_cmfd_current(P, SD, previous_cell_id, segment.cell_id, segment.did_vacuum_reflect, angular_flux, 0, G);
+    previous_cell_id = segment.cell_id;
+
+    if( segment.did_vacuum_reflect )
+      for( int energy_group = 0; energy_group < G_padded; energy_group++ )
+        angular_flux[energy_group] = 0.0f;
+
+    attenuate_segment_groups(P, SD, G, thread_id, angular_flux, source, segment.cell_id, segment.distance);
+  } // end intersection loop
+
+  // Store final angular flux for next iteration
+  for( int energy_group = 0; energy_group < G; energy_group++ )
+    ray_angular_flux[energy_group] = angular_flux[energy_group];
+}
+
+void flux_attenuation_vector_kernel(Parameters P, SimulationData SD, uint64_t ray_id)
+{
+  // Cull threads in case of oversubscription
+  if( ray_id >= P.n_rays )
+    return;
+
+  #define ATTENUATE_RAY_GROUPS(G) attenuate_ray_groups(P, SD, G, ray_id)
+  SPECIALIZE_ON_GROUP_COUNT(P, ATTENUATE_RAY_GROUPS);
+  #undef ATTENUATE_RAY_GROUPS
+}
@@ -0,0 +1,72 @@
+#include "minray.h"
+
+// Turns a cell's linear source moment tallies into its flux gradients, in place.
+// The gradient is the least squares fit of the flux along the tracks that crossed
+// the cell this iteration,
+//
+//   grad(phi) = M^-1 ( m - phi * c )
+//
+// where c and M are the first and (central) second moments of the track length
+// about the cell center, m is the first moment of the flux, and phi is the mean
+// flux along the tracks (all per unit track length). Using the sampled rather than
+// the exact moments of the cell keeps the estimate consistent with the tracks that
+// produced it, so a linear flux is reproduced exactly however the cell was
+// sampled. Must run before normalize_scalar_flux_kernel, as it needs the raw
+// change in angular flux tallies, and the sources of the sweep.
+void compute_flux_gradient_kernel(Parameters P, SimulationData SD, int cell)
+{
+  if( cell >= P.n_cells )
+    return;
+
+  CellData CD = SD.readWriteData.cellData;
+  float * flux_gradient = CD.new_flux_gradient + (uint64_t) cell * P.n_flux_gradient_entries;
+  const float * track_moments = flux_gradient + 2 * P.n_energy_groups;
+  const float * delta_psi = CD.new_scalar_flux + (uint64_t) cell * P.n_energy_groups;
+  const float * isotropic_source = CD.isotropic_source + (uint64_t) cell * P.n_energy_groups;
+  const float * source_gradient = CD.source_gradient + (uint64_t) cell * P.n_energy_groups * 2;
+  const float * Sigma_t = SD.readOnlyData.Sigma_t + SD.readOnlyData.material_id[cell] * P.n_energy_groups;
+
+  double track_length = track_moments[0];
+  double inverse_M[3] = {0.0, 0.0, 0.0};
+  double c_x = 0.0;
+  double c_y = 0.0;
+
+  if( track_length > 0.0 )
+  {
+    c_x = track_moments[1] / track_length;
+    c_y = track_moments[2] / track_length;
+    double M_xx = track_moments[3] / track_length - c_x * c_x;
+    double M_xy = track_moments[4] / track_length - c_x * c_y;
+    double M_yy = track_moments[5] / track_length - c_y * c_y;
+    double determinant = M_xx * M_yy - M_xy * M_xy;
+    double exact_second_moment = P.cell_width * P.cell_width / 12.0;
+
+    // Poorly sampled cells (e.g., crossed by tracks in only one direction) are left flat
+    if( determinant >= LINEAR_SOURCE_MIN_DETERMINANT * exact_second_moment * exact_second_moment )
+    {
+      inverse_M[0] =  M_yy / determinant;
+      inverse_M[1] = -M_xy / determinant;
+      inverse_M[2] =  M_xx / determinant;
+    }
+  }
+
+  for( int energy_group = 0; energy_group < P.n_energy_groups; energy_group++ )
+  {
+    double gradient_x = 0.0;
+    double gradient_y = 0.0;
+
+    if( inverse_M[0] != 0.0 )
+    {
+      double source_x = source_gradient[energy_group * 2];
+      double source_y = source_gradient[energy_group * 2 + 1];
+      double mean_flux = isotropic_source[energy_group] + (source_x * track_moments[1] + source_y * track_moments[2] + delta_psi[energy_group] / Sigma_t[energy_group]) / track_length;
+      double b_x = flux_gradient[energy_group * 2]     / track_length - mean_flux * c_x;
+      double b_y = flux_gradient[energy_group * 2 + 1] / track_length - mean_flux * c_y;
+      gradient_x = inverse_M[0] * b_x + inverse_M[1] * b_y;
+      gradient_y = inverse_M[1] * b_x + inverse_M[2] * b_y;
+    }
+
+    flux_gradient[energy_group * 2]     = gradient_x;
+    flux_gradient[energy_group * 2 + 1] = gradient_y;
+  }
+}
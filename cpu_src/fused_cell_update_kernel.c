@@ -0,0 +1,71 @@
+#include "minray.h"
+#include "group_specialization.h"
+
+// Everything the fused cell update does to one cell (see fused_cell_update):
+// normalizes the scalar flux tallies and adds the source (as
+// normalize_scalar_flux_kernel and add_source_to_scalar_flux_kernel do), adds the
+// result to the accumulators, and computes the fission rates of the old and new
+// scalar fluxes (as compute_cell_fission_rates_kernel does). The arithmetic is
+// the same as in the separate kernels, so both paths give identical results.
+// The new fission rate is also stored in the fission_rate array, for the entropy.
+// The old scalar flux is only read if old_fission_rate is not NULL.
+SPECIALIZED_INLINE void fused_cell_update_groups(Parameters P, SimulationData SD, const int G, int cell, int is_flush_iteration, float * old_fission_rate, float * new_fission_rate)
+{
+  CellData CD = SD.readWriteData.cellData;
+  int material_id = SD.readOnlyData.material_id[cell];
+  const float * Sigma_t    = SD.readOnlyData.Sigma_t    + material_id * G;
+  const float * nu_Sigma_f = SD.readOnlyData.nu_Sigma_f + material_id * G;
+
+  uint64_t flux_idx = (uint64_t) cell * G;
+  float * new_scalar_flux = CD.new_scalar_flux + flux_idx;
+  const float * old_scalar_flux = CD.old_scalar_flux + flux_idx;
+  const float * isotropic_source = CD.isotropic_source + flux_idx;
+  float * scalar_flux_accumulator = CD.scalar_flux_accumulator + flux_idx;
+  float * scalar_flux_sum_of_squares_accumulator = CD.scalar_flux_sum_of_squares_accumulator;
+  if( scalar_flux_sum_of_squares_accumulator != NULL )
+    scalar_flux_sum_of_squares_accumulator += flux_idx;
+
+  int is_fissile = SD.readOnlyData.is_fissile[material_id];
+  double new_rate = 0.0;
+
+  for( int energy_group = 0; energy_group < G; energy_group++ )
+  {
+    float scalar_flux = new_scalar_flux[energy_group];
+    scalar_flux *= P.inverse_total_track_length;
+    scalar_flux /= ((double) Sigma_t[energy_group] * P.cell_volume);
+    scalar_flux += isotropic_source[energy_group];
+    new_scalar_flux[energy_group] = scalar_flux;
+
+    scalar_flux_accumulator[energy_group] += scalar_flux;
+    if( scalar_flux_sum_of_squares_accumulator != NULL )
+      scalar_flux_sum_of_squares_accumulator[energy_group] += scalar_flux * scalar_flux;
+
+    if( is_fissile )
+      new_rate += nu_Sigma_f[energy_group] * scalar_flux;
+  }
+
+  if( old_fission_rate != NULL )
+  {
+    double old_rate = 0.0;
+    if( is_fissile )
+      for( int energy_group = 0; energy_group < G; energy_group++ )
+        old_rate += nu_Sigma_f[energy_group] * old_scalar_flux[energy_group];
+    *old_fission_rate = old_rate * P.cell_volume;
+  }
+
+  if( is_flush_iteration )
+    flush_cell_scalar_flux_accumulators(P, SD, cell);
+
+  *new_fission_rate = new_rate * P.cell_volume;
+  CD.fission_rate[cell] = *new_fission_rate;
+}
+
+void fused_cell_update_kernel(Parameters P, SimulationData SD, int cell, int is_flush_iteration, float * old_fission_rate, float * new_fission_rate)
+{
+  if( cell >= P.n_cells )
+    return;
+
+  #define FUSED_CELL_UPDATE_GROUPS(G) fused_cell_update_groups(P, SD, G, cell, is_flush_iteration, old_fission_rate, new_fission_rate)
+  SPECIALIZE_ON_GROUP_COUNT(P, FUSED_CELL_UPDATE_GROUPS);
+  #undef FUSED_CELL_UPDATE_GROUPS
+}
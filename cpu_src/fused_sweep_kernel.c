@@ -0,0 +1,110 @@
+#include "minray.h"
+#include "exponential.h"
+#include "tally.h"
+#include "cmfd.h"
+#include "group_specialization.h"
+#include "flux_attenuation.h"
+#include "linear_source.h"
+
+// Traces a ray and attenuates its angular flux in all energy groups as each
+// segment is generated, so that no intersection data needs to be stored.
+SPECIALIZED_INLINE void fused_sweep_ray(Parameters P, SimulationData SD, const int G, uint64_t ray_id)
+{
+  const int G_padded = ((G + SIMD_WIDTH - 1) / SIMD_WIDTH) * SIMD_WIDTH;
+
+  // Indexing
+  float * isotropic_source  = SD.readWriteData.cellData.isotropic_source;
+  float * angular_flux      = SD.readWriteData.rayData.angular_flux + ray_id * G;
+
+  int * material_id         = SD.readOnlyData.material_id;
+  float * Sigma_t           = SD.readOnlyData.Sigma_t;
+  int thread_id             = get_thread_num();
+
+  RayState ray = load_ray_state(P, SD.readWriteData.rayData, ray_id);
+  int n_intersections = 0;
+  int previous_cell_id = -1;
+
+  // The vectorized attenuation operates on the angular flux in padded SIMD lanes
+  int is_vectorized = P.attenuation_type == VECTOR_ATTENUATION;
+  float padded_angular_flux[G_padded];
+  float padded_source[G_padded];
+  if( is_vectorized )
+  {
+    for( int energy_group = 0; energy_group < G_padded; energy_group++ )
+    {
+      padded_angular_flux[energy_group] = (energy_group < G) ? angular_flux[energy_group] : 0.0f;
+      padded_source[energy_group] = 0.0f;
+    }
+    angular_flux = padded_angular_flux;
+  }
+
+  // Trace the ray until it has reached its set distance
+  while( ray.distance_travelled < P.distance_per_ray )
+  {
+    // Move the ray across its current cell (the linear source needs where the segment starts)
+    RayState segment_start = ray;
+    Segment segment = trace_segment(P, &ray);
+    uint64_t cell_id = segment.cell_id;
+    SD.readWriteData.cellData.hit_count[cell_id] = 1;
+
+    // Tally the angular flux crossing into this segment to the CMFD coarse mesh
+    tally_cmfd_current(P, SD, previous_cell_id, cell_id, segment.did_vacuum_reflect, angular_flux, 0, G);
+    previous_cell_id = cell_id;
+
+    if( segment.did_vacuum_reflect )
+      for( int energy_group = 0; energy_group < G; energy_group++ )
+        angular_flux[energy_group] = 0.0f;
+
+    // Attenuate the ray's angular flux across this segment
+    if( P.source_type == LINEAR_SOURCE )
+      attenuate_segment_linear_source(P, SD, G, thread_id, angular_flux, segment_start, segment);
+    else if( is_vectorized )
+      attenuate_segment_groups(P, SD, G, thread_id, angular_flux, padded_source, cell_id, segment.distance);
+    else
+    {
+      const float * Sigma_t_cell = Sigma_t + material_id[cell_id] * G;
+      uint64_t flux_idx = cell_id * G;
+      float * tally = get_scalar_flux_tally(P, SD, thread_id, cell_id);
+
+      // Attenuate the ray's angular flux in each group across this segment
+      for( int energy_group = 0; energy_group < G; energy_group++ )
+      {
+        // tau calculation ( tau = Sigma_t * distance )
+        float tau = Sigma_t_cell[energy_group] * segment.distance;
+
+        // Exponential computation ( exponential = 1 - exp( -tau ) )
+        float exponential = exponential_approximation(tau);
+
+        float delta_psi = (angular_flux[energy_group] - isotropic_source[flux_idx + energy_group]) * exponential;
+
+        tally_scalar_flux(P, tally + energy_group, delta_psi);
+
+        angular_flux[energy_group] -= delta_psi;
+      }
+    }
+
+    n_intersections++;
+  }
+
+  // Store final angular flux for next iteration
+  if( is_vectorized )
+    for( int energy_group = 0; energy_group < G; energy_group++ )
+      SD.readWriteData.rayData.angular_flux[ray_id * G + energy_group] = angular_flux[energy_group];
+
+  // Bank the ray's status for use in the next iteration
+  store_ray_state(SD.readWriteData.rayData, ray_id, ray);
+
+  // Bank number of intersections that this ray had this iteration
+  SD.readWriteData.intersectionData.n_intersections[ray_id] = n_intersections;
+}
+
+void fused_sweep_kernel(Parameters P, SimulationData SD, uint64_t ray_id)
+{
+  // Cull threads in case of oversubscription
+  if( ray_id >= P.n_rays )
+    return;
+
+  #define FUSED_SWEEP_RAY(G) fused_sweep_ray(P, SD, G, ray_id)
+  SPECIALIZE_ON_GROUP_COUNT(P, FUSED_SWEEP_RAY);
+  #undef FUSED_SWEEP_RAY
+}
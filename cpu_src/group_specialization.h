@@ -0,0 +1,26 @@
+// Compile-time specialization on the number of energy groups. The group loops of
+// the attenuation, source update, and fission rate kernels are written once, in
+// inline functions taking the group count G as a parameter. SPECIALIZE_ON_GROUP_COUNT
+// then expands a call to one of them into a copy with G a compile-time constant
+// for each of the group counts below, so that the compiler can fully unroll and
+// vectorize its group loops, plus a generic copy with the runtime group count.
+// The copy to run is chosen at startup (see get_specialized_group_count), and
+// reported with the inputs.
+//
+// The group counts here must match those in get_specialized_group_count.
+
+#define SPECIALIZED_INLINE static inline __attribute__((always_inline))
+
+// CALL is the name of a function-like macro taking the group count
+#define SPECIALIZE_ON_GROUP_COUNT(P, CALL) \
+  do { \
+    switch( (P).specialized_group_count ) \
+    { \
+      case 2:  CALL(2);  break; \
+      case 4:  CALL(4);  break; \
+      case 7:  CALL(7);  break; \
+      case 8:  CALL(8);  break; \
+      case 70: CALL(70); break; \
+      default: CALL((P).n_energy_groups); break; \
+    } \
+  } while( 0 )
@@ -1,4 +1,5 @@
 #include "minray.h"
+#include "cell_order.h"
 
 size_t estimate_memory_usage(Parameters P)
 {
@@ -7,20 +8,59 @@ size_t estimate_memory_usage(Parameters P)
   sz += P.n_rays * P.n_energy_groups * sizeof(float);
   sz += (P.n_rays * sizeof(double)) * 4;
   sz += P.n_rays * sizeof(int);
-  // Intersection Data
-  sz += (P.n_rays * P.max_intersections_per_ray * sizeof(int))*3;
-  sz += P.n_rays * P.max_intersections_per_ray * sizeof(double);
+  // Intersection Data (only the per-ray counts are needed by the fused sweep)
+  sz += P.n_rays * sizeof(int);
+  if( P.sweep_type == TWO_PHASE_SWEEP && P.segment_store_type == PADDED_SEGMENTS )
+  {
+    sz += (P.n_rays * P.max_intersections_per_ray * sizeof(int))*2;
+    sz += P.n_rays * P.max_intersections_per_ray * sizeof(double);
+  }
+  // The compact store holds the expected number of segments twice (per-thread buffers and merged)
+  if( P.sweep_type == TWO_PHASE_SWEEP && P.segment_store_type == COMPACT_SEGMENTS )
+  {
+    size_t n_segments = expected_segments_per_ray(P) * P.n_rays;
+    sz += (P.n_rays + 1) * sizeof(uint64_t) + P.n_rays * (sizeof(uint64_t) + sizeof(int));
+    sz += 2 * n_segments * (sizeof(int) + sizeof(float));
+    sz += 2 * ((n_segments + 31) / 32) * sizeof(uint32_t);
+  }
   // Cell Data
   sz += (P.n_cells * P.n_energy_groups * sizeof(float))*4;
+  sz += P.n_cells * P.n_energy_groups * sizeof(double);
+  if( P.target_flux_relative_error > 0.0 )
+    sz += P.n_cells * P.n_energy_groups * (sizeof(float) + sizeof(double));
+  if( P.source_type == LINEAR_SOURCE )
+  {
+    sz += P.n_cells * P.n_energy_groups * 2 * sizeof(float);
+    sz += (P.n_cells * P.n_flux_gradient_entries * sizeof(float))*2;
+  }
   sz += P.n_cells * sizeof(float);
   sz += P.n_cells * sizeof(int);
   // XS Data
   sz += P.n_materials * P.n_energy_groups * sizeof(float)*4;
   sz += P.n_materials * P.n_energy_groups * P.n_energy_groups * sizeof(float);
+  sz += P.n_materials * P.n_energy_groups_padded * sizeof(float);
   sz += P.n_cells * sizeof(int);
+  sz += (P.n_cells + P.n_materials + 1) * sizeof(int);
+  sz += P.n_materials * (2 * P.n_energy_groups + 1) * sizeof(int);
+  sz += cell_order_memory_usage(P);
+  sz += cmfd_memory_usage(P);
+  // Tally Data
+  sz += estimate_tally_memory_usage(P);
   return sz;
 }
 
+// The private tally strategy requires a full copy of the scalar flux array per
+// thread. The linear source flux and track moments are tallied in the same way.
+size_t estimate_tally_memory_usage(Parameters P)
+{
+  size_t n_threads = get_max_threads();
+  int is_linear_source = P.source_type == LINEAR_SOURCE;
+
+  if( P.tally_type == PRIVATE_TALLY )
+    return n_threads * P.n_cells * (P.n_energy_groups + (is_linear_source ? P.n_flux_gradient_entries : 0)) * sizeof(float);
+  return 0;
+}
+
 RayData initialize_ray_data(Parameters P)
 {
   RayData rayData;
@@ -44,8 +84,26 @@ IntersectionData initialize_intersection_data(Parameters P)
 {
   IntersectionData intersectionData;
 
-  size_t sz = P.n_rays * P.max_intersections_per_ray * sizeof(int);
+  size_t sz = P.n_rays * sizeof(int);
   intersectionData.n_intersections     = (int *) malloc(sz);
+
+  intersectionData.cell_ids            = NULL;
+  intersectionData.did_vacuum_reflects = NULL;
+  intersectionData.distances           = NULL;
+  intersectionData.segmentStore        = NULL;
+
+  // The fused sweep attenuates segments as they are traced, so does not need a segment buffer
+  if( P.sweep_type == FUSED_SWEEP )
+    return intersectionData;
+
+  // The compact segment store grows to fit the actual number of segments
+  if( P.segment_store_type == COMPACT_SEGMENTS )
+  {
+    intersectionData.segmentStore = initialize_segment_store(P);
+    return intersectionData;
+  }
+
+  sz = P.n_rays * P.max_intersections_per_ray * sizeof(int);
   intersectionData.cell_ids            = (int *) malloc(sz);
   intersectionData.did_vacuum_reflects = (int *) malloc(sz);
 
@@ -64,6 +122,26 @@ CellData initialize_cell_data(Parameters P)
   CD.new_scalar_flux          = (float *) malloc(sz);
   CD.old_scalar_flux          = (float *) malloc(sz);
   CD.scalar_flux_accumulator  = (float *) malloc(sz);
+  CD.scalar_flux_total        = (double *) calloc(P.n_cells * P.n_energy_groups, sizeof(double));
+
+  // Only needed to estimate the flux uncertainty when stopping on a flux precision target
+  CD.scalar_flux_sum_of_squares_accumulator = NULL;
+  CD.scalar_flux_sum_of_squares_total = NULL;
+  if( P.target_flux_relative_error > 0.0 )
+  {
+    CD.scalar_flux_sum_of_squares_accumulator = (float *) malloc(sz);
+    CD.scalar_flux_sum_of_squares_total = (double *) calloc(P.n_cells * P.n_energy_groups, sizeof(double));
+  }
+
+  CD.source_gradient   = NULL;
+  CD.new_flux_gradient = NULL;
+  CD.old_flux_gradient = NULL;
+  if( P.source_type == LINEAR_SOURCE )
+  {
+    CD.source_gradient   = (float *) malloc(2 * sz);
+    CD.new_flux_gradient = (float *) malloc(P.n_cells * P.n_flux_gradient_entries * sizeof(float));
+    CD.old_flux_gradient = (float *) malloc(P.n_cells * P.n_flux_gradient_entries * sizeof(float));
+  }
 
   sz = P.n_cells * sizeof(float);
   CD.fission_rate             = (float *) malloc(sz);
@@ -74,6 +152,102 @@ CellData initialize_cell_data(Parameters P)
   return CD;
 }
 
+// Copies the total cross sections into a table where each material's row is padded
+// out to a multiple of SIMD_WIDTH with zeros, for use by the vectorized attenuation
+float * initialize_padded_Sigma_t(Parameters P, float * Sigma_t)
+{
+  size_t sz = P.n_materials * P.n_energy_groups_padded * sizeof(float);
+  float * Sigma_t_padded = (float *) calloc(sz, 1);
+
+  for( int material = 0; material < P.n_materials; material++ )
+    for( int energy_group = 0; energy_group < P.n_energy_groups; energy_group++ )
+      Sigma_t_padded[material * P.n_energy_groups_padded + energy_group] = Sigma_t[material * P.n_energy_groups + energy_group];
+
+  return Sigma_t_padded;
+}
+
+// Sorts the cell ids by material (keeping the cell order within each material),
+// for the blocked source update
+int * initialize_material_cells(Parameters P, int * material_id, int ** material_cell_offsets)
+{
+  int * material_cells = (int *) malloc(P.n_cells * sizeof(int));
+  int * offsets = (int *) calloc(P.n_materials + 1, sizeof(int));
+
+  for( uint64_t cell = 0; cell < P.n_cells; cell++ )
+    offsets[material_id[cell] + 1]++;
+  for( int material = 0; material < P.n_materials; material++ )
+    offsets[material + 1] += offsets[material];
+
+  int * next = (int *) malloc(P.n_materials * sizeof(int));
+  memcpy(next, offsets, P.n_materials * sizeof(int));
+  for( uint64_t cell = 0; cell < P.n_cells; cell++ )
+    material_cells[next[material_id[cell]]++] = cell;
+  free(next);
+
+  *material_cell_offsets = offsets;
+  return material_cells;
+}
+
+// Finds the nonzero band of each row of the scattering matrices. The C5G7
+// matrices are mostly lower triangular (downscatter only), with upscatter only
+// into the thermal groups, so most of each row can be skipped.
+int * initialize_scatter_group_range(Parameters P, float * Sigma_s)
+{
+  int G = P.n_energy_groups;
+  int * scatter_group_range = (int *) malloc(P.n_materials * G * 2 * sizeof(int));
+
+  for( int material = 0; material < P.n_materials; material++ )
+    for( int energy_group_in = 0; energy_group_in < G; energy_group_in++ )
+    {
+      const float * row = Sigma_s + ((uint64_t) material * G + energy_group_in) * G;
+      int * range = scatter_group_range + (material * G + energy_group_in) * 2;
+      range[0] = 0;
+      range[1] = 0;
+      for( int energy_group_out = 0; energy_group_out < G; energy_group_out++ )
+        if( row[energy_group_out] != 0.0f )
+        {
+          if( range[1] == 0 )
+            range[0] = energy_group_out;
+          range[1] = energy_group_out + 1;
+        }
+    }
+
+  return scatter_group_range;
+}
+
+// Flags the materials with a fission cross section in any group. The others
+// (e.g., moderator and guide tubes) have no fission source or fission rate.
+int * initialize_fissile_flags(Parameters P, float * nu_Sigma_f)
+{
+  int * is_fissile = (int *) calloc(P.n_materials, sizeof(int));
+
+  for( int material = 0; material < P.n_materials; material++ )
+    for( int energy_group = 0; energy_group < P.n_energy_groups; energy_group++ )
+      if( nu_Sigma_f[material * P.n_energy_groups + energy_group] != 0.0f )
+        is_fissile[material] = 1;
+
+  return is_fissile;
+}
+
+TallyData initialize_tally_data(Parameters P)
+{
+  TallyData TD;
+  TD.n_threads = get_max_threads();
+  TD.private_scalar_flux = NULL;
+  TD.private_flux_moments = NULL;
+  int is_linear_source = P.source_type == LINEAR_SOURCE;
+
+  if( P.tally_type == PRIVATE_TALLY )
+  {
+    size_t sz = TD.n_threads * P.n_cells * P.n_energy_groups * sizeof(float);
+    TD.private_scalar_flux = (float *) calloc(sz, 1);
+    if( is_linear_source )
+      TD.private_flux_moments = (float *) calloc(TD.n_threads * P.n_cells * P.n_flux_gradient_entries, sizeof(float));
+  }
+
+  return TD;
+}
+
 SimulationData initialize_simulation(Parameters P)
 {
   border_print();
@@ -81,13 +255,23 @@ SimulationData initialize_simulation(Parameters P)
   border_print();
 
   printf("Initializing read only data...\n");
-  ReadOnlyData ROD = load_2D_C5G7_XS(P);
+  ReadOnlyData ROD;
+  if( P.problem_file != NULL )
+    ROD = load_problem_file(P);
+  else
+    ROD = load_2D_C5G7_XS(P);
+  ROD.Sigma_t_padded = initialize_padded_Sigma_t(P, ROD.Sigma_t);
+  ROD.material_cells = initialize_material_cells(P, ROD.material_id, &ROD.material_cell_offsets);
+  ROD.scatter_group_range = initialize_scatter_group_range(P, ROD.Sigma_s);
+  ROD.is_fissile = initialize_fissile_flags(P, ROD.nu_Sigma_f);
   
   printf("Initializing read/write data...\n");
   ReadWriteData RWD;
   RWD.intersectionData = initialize_intersection_data(P);
   RWD.rayData          = initialize_ray_data(P);
   RWD.cellData         = initialize_cell_data(P);
+  RWD.tallyData        = initialize_tally_data(P);
+  RWD.cmfdData         = initialize_cmfd_data(P);
 
   SimulationData SD;
   SD.readOnlyData  = ROD;
@@ -98,8 +282,68 @@ SimulationData initialize_simulation(Parameters P)
   return SD;
 }
 
+// Frees all data allocated by initialize_simulation (along with any segment
+// buffers allocated since). Cross sections used in place from a
+// problem file are unmapped rather than freed.
+void free_simulation(Parameters P, SimulationData SD)
+{
+  ReadOnlyData ROD = SD.readOnlyData;
+  free(ROD.material_id);
+  if( ROD.problem_file_mapping != NULL )
+    unmap_problem_file(ROD);
+  else
+  {
+    free(ROD.nu_Sigma_f);
+    free(ROD.Sigma_f);
+    free(ROD.Sigma_t);
+    free(ROD.Sigma_s);
+    free(ROD.Chi);
+  }
+  free(ROD.Sigma_t_padded);
+  free(ROD.material_cells);
+  free(ROD.material_cell_offsets);
+  free(ROD.scatter_group_range);
+  free(ROD.is_fissile);
+
+  RayData RD = SD.readWriteData.rayData;
+  free(RD.angular_flux);
+  free(RD.location_x);
+  free(RD.location_y);
+  free(RD.direction_x);
+  free(RD.direction_y);
+  free(RD.cell_id);
+
+  IntersectionData ID = SD.readWriteData.intersectionData;
+  free(ID.n_intersections);
+  free(ID.cell_ids);
+  free(ID.distances);
+  free(ID.did_vacuum_reflects);
+  if( ID.segmentStore != NULL )
+    free_segment_store(ID.segmentStore);
+
+  CellData CD = SD.readWriteData.cellData;
+  free(CD.isotropic_source);
+  free(CD.new_scalar_flux);
+  free(CD.old_scalar_flux);
+  free(CD.scalar_flux_accumulator);
+  free(CD.scalar_flux_sum_of_squares_accumulator);
+  free(CD.scalar_flux_total);
+  free(CD.scalar_flux_sum_of_squares_total);
+  free(CD.source_gradient);
+  free(CD.new_flux_gradient);
+  free(CD.old_flux_gradient);
+  free(CD.hit_count);
+  free(CD.fission_rate);
+
+  TallyData TD = SD.readWriteData.tallyData;
+  free(TD.private_scalar_flux);
+  free(TD.private_flux_moments);
+
+  free_cmfd_data(SD.readWriteData.cmfdData);
+}
+
 #define PRNG_SAMPLES_PER_RAY 10
-void initialize_ray_kernel(uint64_t base_seed, int ray_id, double length_per_dimension, int n_cells_per_dimension, double inverse_cell_width, RayData RD)
+void initialize_ray_kernel(Parameters P, uint64_t base_seed, int ray_id, double length_per_dimension, double inverse_cell_width, RayData RD)
 {
     uint64_t offset = ray_id * PRNG_SAMPLES_PER_RAY;
     uint64_t seed = fast_forward_LCG(base_seed, offset);
@@ -131,7 +375,7 @@ void initialize_ray_kernel(uint64_t base_seed, int ray_id, double length_per_dim
     // Compute Starting Cell ID
     int x_idx = RD.location_x[ray_id] * inverse_cell_width;
     int y_idx = RD.location_y[ray_id] * inverse_cell_width;
-    int cell_id = y_idx * n_cells_per_dimension + x_idx;
+    int cell_id = get_cell_id(P, x_idx, y_idx);
 
     // Store sampled ray data
     RD.cell_id[    ray_id] = cell_id; 
@@ -144,7 +388,7 @@ void initialize_rays(Parameters P, SimulationData SD)
   // Sample all rays in space and angle
   for( int r = 0; r < P.n_rays; r++ )
   {
-    initialize_ray_kernel(P.seed, r, P.length_per_dimension, P.n_cells_per_dimension, P.inverse_cell_width, SD.readWriteData.rayData);
+    initialize_ray_kernel(P, P.seed, r, P.length_per_dimension, P.inverse_cell_width, SD.readWriteData.rayData);
   }
 }
 
@@ -159,8 +403,14 @@ void initialize_fluxes(Parameters P, SimulationData SD)
     }
   }
 
+  // Start from a flat flux within each cell
+  if( SD.readWriteData.cellData.old_flux_gradient != NULL )
+    memset(SD.readWriteData.cellData.old_flux_gradient, 0, P.n_cells * P.n_flux_gradient_entries * sizeof(float));
+
   // Set scalar flux accumulators to 0.0
   memset(SD.readWriteData.cellData.scalar_flux_accumulator, 0, P.n_cells * P.n_energy_groups * sizeof(float));
+  if( SD.readWriteData.cellData.scalar_flux_sum_of_squares_accumulator != NULL )
+    memset(SD.readWriteData.cellData.scalar_flux_sum_of_squares_accumulator, 0, P.n_cells * P.n_energy_groups * sizeof(float));
 
   // Set all starting angular fluxes to 0.0
   memset(SD.readWriteData.rayData.angular_flux, 0, P.n_rays * P.n_energy_groups * sizeof(float));
@@ -1,4 +1,6 @@
 #include "minray.h"
+#include "segment_store.h"
+#include "cell_order.h"
 
 // Prints Section titles in center of 80 char terminal
 void center_print(const char *s, int width)
@@ -80,13 +82,109 @@ void print_user_inputs(Parameters P)
   printf("Number of Rays per Iteration      = %lu\n",   P.n_rays);
   printf("Length of each ray [cm]           = %.2lf\n", P.distance_per_ray);
   printf("Energy Groups                     = %d\n",    P.n_energy_groups);
-  printf("Number of Inactive Iterations     = %d\n",    P.n_inactive_iterations);
-  printf("Number of Active Iterations       = %d\n",    P.n_active_iterations);
+  if( P.n_coarse_mesh_levels > 0 )
+  {
+    char sequence[256] = "";
+    for( int level = 0; level < P.n_coarse_mesh_levels; level++ )
+      sprintf(sequence + strlen(sequence), "%d -> ", P.coarse_mesh_multipliers[level]);
+    printf("Mesh Sequence Multipliers         = %s%d\n", sequence, P.problem_size_multiplier);
+    if( P.auto_inactive_enabled )
+      printf("Coarsest Mesh Inactive Iterations = Automatic (max %d)\n", P.n_coarse_inactive_iterations);
+    else
+      printf("Coarsest Mesh Inactive Iterations = %d\n", P.n_coarse_inactive_iterations);
+  }
+  if( P.auto_inactive_enabled && P.n_coarse_mesh_levels == 0 )
+    printf("Number of Inactive Iterations     = Automatic (max %d)\n", P.n_inactive_iterations);
+  else
+    printf("Number of Inactive Iterations     = %d\n",    P.n_inactive_iterations);
+  if( P.target_k_eff_std_dev > 0.0 || P.target_flux_relative_error > 0.0 )
+    printf("Number of Active Iterations       = Until Precise (max %d)\n", P.n_active_iterations);
+  else
+    printf("Number of Active Iterations       = %d\n",    P.n_active_iterations);
+  if( P.target_k_eff_std_dev > 0.0 )
+    printf("Target k-effective std. dev.      = %.2le\n", P.target_k_eff_std_dev);
+  if( P.target_flux_relative_error > 0.0 )
+    printf("Target Max Flux Relative Error    = %.2le\n", P.target_flux_relative_error);
   printf("Pseudorandom Seed                 = %lu\n",   P.seed);
-  printf("Maximum Intersections per Ray     = %d\n",    P.max_intersections_per_ray);
+  if( P.sweep_type == FUSED_SWEEP )
+    printf("Transport Sweep Type              = Fused\n");
+  else
+  {
+    printf("Transport Sweep Type              = Two-Phase\n");
+    if( P.segment_store_type == COMPACT_SEGMENTS )
+      printf("Segment Storage                   = Compact\n");
+    else
+    {
+      printf("Segment Storage                   = Padded\n");
+      printf("Maximum Intersections per Ray     = %d\n",    P.max_intersections_per_ray);
+    }
+  }
   size_t bytes = estimate_memory_usage(P);
   double MB = (double) bytes / 1024.0 /1024.0;
   printf("Estimated Memory Usage            = %.2lf [MB]\n", MB);
+  if( P.ray_trace_method == DDA_RAY_TRACE )
+    printf("Ray Tracing Method                = DDA\n");
+  else
+    printf("Ray Tracing Method                = Legacy\n");
+  if( P.source_type == LINEAR_SOURCE )
+    printf("Flux Attenuation Kernel           = Linear Source\n");
+  else if( P.attenuation_type == VECTOR_ATTENUATION )
+    printf("Flux Attenuation Kernel           = Vector (%d lanes)\n", P.n_energy_groups_padded);
+  else
+    printf("Flux Attenuation Kernel           = Scalar\n");
+  char * tally_strings[2] = {"Atomic", "Private"};
+  printf("Scalar Flux Tally Strategy        = %s\n", tally_strings[P.tally_type]);
+  if( P.cell_update_type == FUSED_CELL_UPDATE )
+    printf("Cell Update                       = Fused\n");
+  else
+    printf("Cell Update                       = Separate\n");
+  if( P.source_update_type == BLOCKED_SOURCE_UPDATE )
+    printf("Source Update                     = Blocked (%d cells per block)\n", SOURCE_UPDATE_BLOCK_SIZE);
+  else
+    printf("Source Update                     = Cell\n");
+  if( P.specialized_group_count > 0 )
+    printf("Energy Group Kernels              = Specialized (%d groups)\n", P.specialized_group_count);
+  else
+    printf("Energy Group Kernels              = Generic (%d groups)\n", P.n_energy_groups);
+  if( P.tally_type != ATOMIC_TALLY )
+    printf("Tally Memory Overhead             = %.2lf [MB]\n", estimate_tally_memory_usage(P) / 1024.0 / 1024.0);
+  if( P.problem_file != NULL )
+    printf("Problem Data                      = %s\n", P.problem_file);
+  else
+    printf("Problem Data                      = %s/\n", P.data_directory);
+  if( P.problem_file == NULL && P.geometry_source == FILE_GEOMETRY )
+    printf("Material Map                      = File\n");
+  else if( P.problem_file == NULL )
+    printf("Material Map                      = Procedural\n");
+  if( P.cell_order == MORTON_CELLS )
+    printf("Cell Numbering                    = Morton\n");
+  else
+    printf("Cell Numbering                    = Row-Major\n");
+  if( P.ray_sort_interval > 0 )
+    printf("Ray Sort Interval                 = %d iterations\n", P.ray_sort_interval);
+  else
+    printf("Ray Sort Interval                 = Disabled\n");
+  if( P.cmfd_type != NO_CMFD )
+    printf("CMFD Acceleration                 = Pin-Cell Mesh (%d x %d coarse cells)\n", P.n_cmfd_cells_per_dimension, P.n_cmfd_cells_per_dimension);
+  else
+    printf("CMFD Acceleration                 = Disabled\n");
+  if( P.checkpoint_file != NULL )
+  {
+    if( P.checkpoint_interval > 0 )
+      printf("Checkpoint File                   = %s (every %d iterations)\n", P.checkpoint_file, P.checkpoint_interval);
+    else
+      printf("Checkpoint File                   = %s\n", P.checkpoint_file);
+  }
+  if( P.restart_file != NULL )
+    printf("Restart File                      = %s\n", P.restart_file);
+  if( P.perf_counters_enabled )
+    printf("Hardware Counters                 = Enabled\n");
+  else
+    printf("Hardware Counters                 = Disabled\n");
+  if( P.pin_powers_enabled )
+    printf("Pin Powers                        = Enabled\n");
+  else
+    printf("Pin Powers                        = Disabled\n");
   if( P.plotting_enabled )
     printf("Plotting                          = Enabled\n");
   else
@@ -108,21 +206,209 @@ int print_results(Parameters P, SimulationResult SR)
   border_print();
   printf("k-effective                       = %.5f\n", SR.k_eff);
   printf("k-effective std. dev.             = %.5f\n", SR.k_eff_std_dev);
+  printf("Final Fission Source Entropy      = %.5f\n", SR.shannon_entropy);
+  if( P.auto_inactive_enabled && P.n_coarse_mesh_levels == 0 )
+  {
+    if( SR.source_converged_iteration >= 0 )
+      printf("Source Converged at Iteration     = %d\n", SR.source_converged_iteration);
+    else
+      printf("Source Converged at Iteration     = Not Converged\n");
+  }
+  if( P.restart_file != NULL )
+    printf("Restarted at Iteration            = %d\n", SR.first_iteration);
+  printf("Inactive Iterations Run           = %d\n", SR.n_inactive_iterations);
+  printf("Active Iterations Run             = %d\n", SR.n_active_iterations);
+  if( P.target_flux_relative_error > 0.0 )
+    printf("Max Flux Relative Error           = %.3le\n", SR.max_flux_relative_error);
+  if( P.n_coarse_mesh_levels > 0 )
+    printf("Coarse Mesh Sequence Runtime      = %.3le [s]\n", SR.runtime_mesh_sequence);
   printf("Simulation Runtime                = %.3le [s]\n", SR.runtime_total);
+  if( P.pin_powers_enabled )
+  {
+    printf("Pin Power RMS Error               = %.3lf%%\n", SR.pin_power_rms_error);
+    printf("Pin Power Max Error               = %.3lf%%\n", SR.pin_power_max_error);
+    printf("Pin Power Figure of Merit         = %.3le [1/(%%^2 s)]\n", get_pin_power_figure_of_merit(SR));
+  }
   printf("    Transport Sweep Time          = %.3le [s] (%.2lf%%)\n", SR.runtime_transport_sweep, 100.0 * SR.runtime_transport_sweep / SR.runtime_total);
   printf("    Iteration Time                = %.3le [s] (%.2lf%%)\n", SR.runtime_total - SR.runtime_transport_sweep, 100.0* (1.0 - SR.runtime_transport_sweep / SR.runtime_total));
+  if( P.tally_type != ATOMIC_TALLY )
+    printf("Tally Memory Overhead             = %.2lf [MB]\n", estimate_tally_memory_usage(P) / 1024.0 / 1024.0);
+  if( P.sweep_type == TWO_PHASE_SWEEP && P.segment_store_type == COMPACT_SEGMENTS )
+    printf("Segment Storage Memory            = %.2lf [MB]\n", SR.segment_store_memory_usage / 1024.0 / 1024.0);
   printf("Number of Geometric Intersections = %.3le\n", (double) SR.n_geometric_intersections);
-  printf("Avg. Geom. Intersections per Ray  = %.1lf\n", SR.n_geometric_intersections / ((double)P.n_rays * P.n_iterations));
+  printf("Avg. Geom. Intersections per Ray  = %.1lf\n", SR.n_geometric_intersections / ((double)P.n_rays * (SR.n_iterations - SR.first_iteration)));
   printf("Number of Integrations            = %.3le\n", (double) SR.n_geometric_intersections * P.n_energy_groups);
   double time_per_integration = SR.runtime_total * 1.0e9 / ( SR.n_geometric_intersections * P.n_energy_groups);
   printf("Time per Integration (TPI)        = %.3lf [ns]\n", time_per_integration);
-  printf("Est. Total Time Req. to Converge  = %.3le [s]\n", (SR.runtime_total / P.n_iterations) * 2000.0);
+  if( SR.timers.perf != NULL )
+  {
+    // Hardware counters summed over all transport sweep phases
+    uint64_t sweep_counts[N_PERF_EVENTS] = {0};
+    int sweep_phases[4] = {PHASE_RAY_TRACE, PHASE_FLUX_ATTENUATION, PHASE_FUSED_SWEEP, PHASE_TALLY_REDUCTION};
+    for( int i = 0; i < 4; i++ )
+      for( int event = 0; event < N_PERF_EVENTS; event++ )
+        sweep_counts[event] += SR.timers.counts[sweep_phases[i]][event];
+    printf("    Sweep Instructions per Cycle  = %.3lf\n", (double) sweep_counts[PERF_INSTRUCTIONS] / sweep_counts[PERF_CYCLES]);
+    printf("    Sweep LLC Misses per Segment  = %.3lf\n", (double) sweep_counts[PERF_LLC_MISSES] / SR.n_geometric_intersections);
+    printf("    Sweep Branch Misses per Seg.  = %.3lf\n", (double) sweep_counts[PERF_BRANCH_MISSES] / SR.n_geometric_intersections);
+  }
+  printf("Est. Total Time Req. to Converge  = %.3le [s]\n", (SR.runtime_total / (SR.n_iterations - SR.first_iteration)) * 2000.0);
+  print_phase_timers(P, SR);
   int is_valid_result = validate_results(P.validation_problem_id, SR.k_eff);
   border_print();
   return is_valid_result;
 }
 
-void print_status_data(int iter, double k_eff, double percent_missed, int is_active_region, double k_eff_total_accumulator, double k_eff_sum_of_squares_accumulator, int n_active_iterations)
+// Prints the time spent in each phase of the power iteration. Throughput is given in
+// segments per second (i.e., the total number of geometric intersections divided by
+// the phase time), along with an estimate of the memory bandwidth the phase achieved.
+void print_phase_timers(Parameters P, SimulationResult SR)
+{
+  border_print();
+  center_print("KERNEL TIMING", 79);
+  border_print();
+  printf("%-26s %10s %10s %14s %12s\n", "Phase", "Time [s]", "% Runtime", "Segments/s", "Est. GB/s");
+
+  double time_in_phases = 0.0;
+  for( int phase = 0; phase < N_PHASES; phase++ )
+  {
+    if( SR.timers.n_calls[phase] == 0 )
+      continue;
+    double time = SR.timers.time[phase];
+    double bytes = estimate_phase_bytes(P, phase, SR.timers.n_calls[phase], SR.n_geometric_intersections);
+    printf("%-26s %10.3le %9.2lf%% %14.3le %12.2lf\n", get_phase_name(phase), time, 100.0 * time / SR.runtime_total,
+        SR.n_geometric_intersections / time, bytes / time / 1.0e9);
+    time_in_phases += time;
+  }
+  double time_other = SR.runtime_total - time_in_phases;
+  printf("%-26s %10.3le %9.2lf%%\n", "Other", time_other, 100.0 * time_other / SR.runtime_total);
+
+  // Hardware counters, normalized per segment so that phases can be compared directly
+  // with each other and with the TPI metric
+  if( SR.timers.perf != NULL )
+  {
+    border_print();
+    center_print("HARDWARE COUNTERS", 79);
+    border_print();
+    printf("%-26s %8s %12s %12s %14s\n", "Phase", "IPC", "Cycles/Seg", "Instr/Seg", "LLC Miss/Seg");
+    for( int phase = 0; phase < N_PHASES; phase++ )
+    {
+      if( SR.timers.n_calls[phase] == 0 )
+        continue;
+      uint64_t * counts = SR.timers.counts[phase];
+      double n_segments = SR.n_geometric_intersections;
+      printf("%-26s %8.3lf %12.2lf %12.2lf %14.4lf\n", get_phase_name(phase),
+          counts[PERF_CYCLES] ? (double) counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES] : 0.0,
+          counts[PERF_CYCLES] / n_segments, counts[PERF_INSTRUCTIONS] / n_segments, counts[PERF_LLC_MISSES] / n_segments);
+    }
+  }
+  border_print();
+}
+
+// Writes the inputs, results, and per-phase timings in JSON format
+void write_summary(Parameters P, SimulationResult SR, int is_valid_result)
+{
+  FILE * fp = fopen(P.summary_file, "w");
+  if( fp == NULL )
+  {
+    printf("ERROR: Unable to open summary file \"%s\" for writing\n", P.summary_file);
+    return;
+  }
+
+  char * sweep_strings[2] = {"two-phase", "fused"};
+  char * tracer_strings[2] = {"legacy", "dda"};
+  char * attenuation_strings[2] = {"scalar", "vector"};
+  char * source_strings[2] = {"flat", "linear"};
+  char * cell_update_strings[2] = {"separate", "fused"};
+  char * source_update_strings[2] = {"cell", "blocked"};
+  char * tally_strings[2] = {"atomic", "private"};
+  char * segment_strings[2] = {"padded", "compact"};
+  char * cell_order_strings[2] = {"row-major", "morton"};
+  char * cmfd_strings[2] = {"none", "pin"};
+  char * validation_strings[4] = {"none", "small", "medium", "large"};
+
+  fprintf(fp, "{\n");
+  fprintf(fp, "  \"version\": \"%s\",\n", VERSION);
+  fprintf(fp, "  \"inputs\": {\n");
+  fprintf(fp, "    \"n_cells_per_dimension\": %d,\n", P.n_cells_per_dimension);
+  fprintf(fp, "    \"n_cells\": %lu,\n", P.n_cells);
+  fprintf(fp, "    \"n_energy_groups\": %d,\n", P.n_energy_groups);
+  fprintf(fp, "    \"n_rays\": %lu,\n", P.n_rays);
+  fprintf(fp, "    \"distance_per_ray\": %.6lf,\n", P.distance_per_ray);
+  fprintf(fp, "    \"n_inactive_iterations\": %d,\n", P.n_inactive_iterations);
+  fprintf(fp, "    \"n_active_iterations\": %d,\n", P.n_active_iterations);
+  fprintf(fp, "    \"seed\": %lu,\n", P.seed);
+  fprintf(fp, "    \"sweep\": \"%s\",\n", sweep_strings[P.sweep_type]);
+  fprintf(fp, "    \"tracer\": \"%s\",\n", tracer_strings[P.ray_trace_method]);
+  fprintf(fp, "    \"attenuation\": \"%s\",\n", attenuation_strings[P.attenuation_type]);
+  fprintf(fp, "    \"source\": \"%s\",\n", source_strings[P.source_type]);
+  fprintf(fp, "    \"cell_update\": \"%s\",\n", cell_update_strings[P.cell_update_type]);
+  fprintf(fp, "    \"source_update\": \"%s\",\n", source_update_strings[P.source_update_type]);
+  fprintf(fp, "    \"specialized_group_count\": %d,\n", P.specialized_group_count);
+  fprintf(fp, "    \"tally\": \"%s\",\n", tally_strings[P.tally_type]);
+  fprintf(fp, "    \"segments\": \"%s\",\n", segment_strings[P.segment_store_type]);
+  fprintf(fp, "    \"sort_interval\": %d,\n", P.ray_sort_interval);
+  fprintf(fp, "    \"cell_order\": \"%s\",\n", cell_order_strings[P.cell_order]);
+  fprintf(fp, "    \"cmfd\": \"%s\",\n", cmfd_strings[P.cmfd_type]);
+  fprintf(fp, "    \"mesh_sequence\": [");
+  for( int level = 0; level < P.n_coarse_mesh_levels; level++ )
+    fprintf(fp, "%d, ", P.coarse_mesh_multipliers[level]);
+  fprintf(fp, "%d],\n", P.problem_size_multiplier);
+  fprintf(fp, "    \"n_coarse_inactive_iterations\": %d,\n", P.n_coarse_inactive_iterations);
+  fprintf(fp, "    \"n_fine_inactive_iterations\": %d,\n", (P.n_coarse_mesh_levels > 0) ? P.n_fine_inactive_iterations : 0);
+  fprintf(fp, "    \"auto_inactive\": %s,\n", P.auto_inactive_enabled ? "true" : "false");
+  fprintf(fp, "    \"target_k_eff_std_dev\": %.6le,\n", P.target_k_eff_std_dev);
+  fprintf(fp, "    \"target_flux_relative_error\": %.6le,\n", P.target_flux_relative_error);
+  fprintf(fp, "    \"n_threads\": %d\n", get_max_threads());
+  fprintf(fp, "  },\n");
+  fprintf(fp, "  \"results\": {\n");
+  fprintf(fp, "    \"k_eff\": %.7lf,\n", SR.k_eff);
+  fprintf(fp, "    \"k_eff_std_dev\": %.7lf,\n", SR.k_eff_std_dev);
+  fprintf(fp, "    \"shannon_entropy\": %.7lf,\n", SR.shannon_entropy);
+  fprintf(fp, "    \"restart_iteration\": %d,\n", SR.first_iteration);
+  fprintf(fp, "    \"n_inactive_iterations_run\": %d,\n", SR.n_inactive_iterations);
+  fprintf(fp, "    \"source_converged_iteration\": %d,\n", SR.source_converged_iteration);
+  fprintf(fp, "    \"n_active_iterations_run\": %d,\n", SR.n_active_iterations);
+  fprintf(fp, "    \"max_flux_relative_error\": %.6le,\n", SR.max_flux_relative_error);
+  fprintf(fp, "    \"runtime_mesh_sequence\": %.6le,\n", SR.runtime_mesh_sequence);
+  if( P.pin_powers_enabled )
+  {
+    fprintf(fp, "    \"pin_power_rms_error\": %.6le,\n", SR.pin_power_rms_error);
+    fprintf(fp, "    \"pin_power_max_error\": %.6le,\n", SR.pin_power_max_error);
+    fprintf(fp, "    \"pin_power_figure_of_merit\": %.6le,\n", get_pin_power_figure_of_merit(SR));
+  }
+  fprintf(fp, "    \"runtime_total\": %.6le,\n", SR.runtime_total);
+  fprintf(fp, "    \"runtime_transport_sweep\": %.6le,\n", SR.runtime_transport_sweep);
+  fprintf(fp, "    \"n_geometric_intersections\": %lu,\n", SR.n_geometric_intersections);
+  fprintf(fp, "    \"estimated_memory_usage\": %lu,\n", estimate_memory_usage(P));
+  fprintf(fp, "    \"tally_memory_usage\": %lu,\n", estimate_tally_memory_usage(P));
+  fprintf(fp, "    \"segment_store_memory_usage\": %lu,\n", SR.segment_store_memory_usage);
+  fprintf(fp, "    \"time_per_integration_ns\": %.6lf,\n", SR.runtime_total * 1.0e9 / ( SR.n_geometric_intersections * P.n_energy_groups));
+  fprintf(fp, "    \"validation_problem\": \"%s\",\n", validation_strings[P.validation_problem_id]);
+  fprintf(fp, "    \"validation_passed\": %s\n", (P.validation_problem_id && is_valid_result == 0) ? "true" : "false");
+  fprintf(fp, "  },\n");
+  fprintf(fp, "  \"phases\": [\n");
+  int is_first = 1;
+  for( int phase = 0; phase < N_PHASES; phase++ )
+  {
+    if( SR.timers.n_calls[phase] == 0 )
+      continue;
+    double time = SR.timers.time[phase];
+    double bytes = estimate_phase_bytes(P, phase, SR.timers.n_calls[phase], SR.n_geometric_intersections);
+    fprintf(fp, "%s    {\"name\": \"%s\", \"time\": %.6le, \"calls\": %lu, \"segments_per_second\": %.6le, \"est_bytes\": %.6le, \"est_gb_per_second\": %.6lf",
+        is_first ? "" : ",\n", get_phase_key(phase), time, SR.timers.n_calls[phase], SR.n_geometric_intersections / time, bytes, bytes / time / 1.0e9);
+    if( SR.timers.perf != NULL )
+      for( int event = 0; event < N_PERF_EVENTS; event++ )
+        fprintf(fp, ", \"%s\": %lu", get_perf_event_key(event), SR.timers.counts[phase][event]);
+    fprintf(fp, "}");
+    is_first = 0;
+  }
+  fprintf(fp, "\n  ]\n");
+  fprintf(fp, "}\n");
+  fclose(fp);
+}
+
+void print_status_data(int iter, double k_eff, double entropy, double percent_missed, int is_active_region, double k_eff_total_accumulator, double k_eff_sum_of_squares_accumulator, int n_active_iterations)
 {
   char color[64] = "";
   char color_reset[64] = "";
@@ -149,7 +435,7 @@ void print_status_data(int iter, double k_eff, double percent_missed, int is_act
     sprintf(active_info, "Inactive");
 
   // Print status data
-  printf("Iter %5d   k = %.5lf   %sMiss Rate = %.2le%s   %s\n", iter, k_eff, color, percent_missed / 100.0, color_reset, active_info);
+  printf("Iter %5d   k = %.5lf   H = %.5lf   %sMiss Rate = %.2le%s   %s\n", iter, k_eff, entropy, color, percent_missed / 100.0, color_reset, active_info);
 }
 
 // print error to screen, inform program options
@@ -160,11 +446,37 @@ void print_CLI_error(void)
   printf("    -r <rays>                    Number of discrete rays\n");
   printf("    -d <distance per ray>        Travel distance per ray (cm)\n");
   printf("    -i <inactive iterations>     Set fixed number of inactive power iterations\n");
+  printf("    --auto-inactive              End the inactive iterations once the fission source converges (-i sets the maximum)\n");
   printf("    -a <active iterations>       Set fixed number of active power iterations\n");
+  printf("    --mesh-sequence <m1,m2,...> Converge the fission source on coarser meshes first (-i sets the coarsest mesh's iterations)\n");
+  printf("    --mesh-sequence-fine-inactive <iterations> Inactive iterations on each finer mesh of the sequence (default min(-i, %d))\n", MESH_SEQUENCE_INACTIVE_ITERATIONS);
+  printf("    --checkpoint <file>          Write the simulation state to a checkpoint file after the final iteration\n");
+  printf("    --checkpoint-interval <iterations> Also write the checkpoint every N iterations (default 0, disabled)\n");
+  printf("    --restart <file>             Continue the simulation from a checkpoint file\n");
+  printf("    --target-k-std-dev <std dev> End the active iterations once k-eff reaches this std. dev. (-a sets the maximum)\n");
+  printf("    --target-flux-error <error>  End the active iterations once every cell's flux reaches this relative error (-a sets the maximum)\n");
   printf("    -s <seed>                    Random number generator seed (for reproducibility)\n");
   printf("    -m <problem size multiplier> Multiplioer to increase problem size/resolution\n");
   printf("    -p                           Enables plotting\n");
   printf("    -v <small, medium, large>    Executes a specific validation probem to test for correctness\n");
+  printf("    --sweep <two-phase, fused>   Transport sweep type (default two-phase)\n");
+  printf("    --tracer <dda, legacy>       Ray tracing method (default dda)\n");
+  printf("    --attenuation <vector, scalar> Flux attenuation kernel (default vector)\n");
+  printf("    --source <flat, linear>      Source approximation within each cell (default flat, linear requires --sweep fused)\n");
+  printf("    --tally <atomic, private>    Scalar flux tally strategy (default atomic)\n");
+  printf("    --cell-update <fused, separate> Cell update passes between transport sweeps (default fused)\n");
+  printf("    --source-update <blocked, cell> Source update by blocks of same-material cells, or cell by cell (default blocked)\n");
+  printf("    --segments <compact, padded> Two-phase sweep segment storage (default compact)\n");
+  printf("    --sort-interval <iterations> Spatially sort rays every N iterations (default 0, disabled)\n");
+  printf("    --cell-order <row-major, morton> Cell numbering of all per-cell arrays (default row-major)\n");
+  printf("    --cmfd <none, pin>           CMFD acceleration of the inactive iterations (default none)\n");
+  printf("    --geometry <procedural, file> Generate the C5G7 material map, or read it from the data directory (default procedural)\n");
+  printf("    --summary <file>             Write a machine-readable (JSON) summary of the results\n");
+  printf("    --perf-counters              Collect hardware performance counters for each phase (Linux only)\n");
+  printf("    --pin-powers                 Compare the pin powers against the reference solution in the data directory\n");
+  printf("    --data-dir <path>            Directory holding the C5G7 text data (default ../data/C5G7_2D)\n");
+  printf("    --problem <file>             Load a binary problem file instead of the text data\n");
+  printf("    --write-problem <file>       Convert the text data into a binary problem file and exit\n");
 
   printf("See readme for full description of default run values\n");
   exit(1);
@@ -185,6 +497,33 @@ Parameters read_CLI(int argc, char * argv[])
   P.n_energy_groups = 7;
   P.plotting_enabled = 0;
   P.validation_problem_id = NONE;
+  P.sweep_type = TWO_PHASE_SWEEP;
+  P.ray_trace_method = DDA_RAY_TRACE;
+  P.attenuation_type = VECTOR_ATTENUATION;
+  P.source_type = FLAT_SOURCE;
+  P.cell_update_type = FUSED_CELL_UPDATE;
+  P.source_update_type = BLOCKED_SOURCE_UPDATE;
+  P.tally_type = ATOMIC_TALLY;
+  P.segment_store_type = COMPACT_SEGMENTS;
+  P.ray_sort_interval = 0;
+  P.cell_order = ROW_MAJOR_CELLS;
+  P.data_directory = "../data/C5G7_2D";
+  P.problem_file = NULL;
+  P.geometry_source = PROCEDURAL_GEOMETRY;
+  P.summary_file = NULL;
+  P.perf_counters_enabled = 0;
+  P.pin_powers_enabled = 0;
+  P.cmfd_type = NO_CMFD;
+  P.auto_inactive_enabled = 0;
+  P.target_k_eff_std_dev = 0.0;
+  P.target_flux_relative_error = 0.0;
+  P.n_coarse_mesh_levels = 0;
+  P.n_coarse_inactive_iterations = 0;
+  P.n_fine_inactive_iterations = -1;
+  P.checkpoint_file = NULL;
+  P.checkpoint_interval = 0;
+  P.restart_file = NULL;
+  P.output_problem_file = NULL;
 
   P.boundary_conditions[1][1] = NONE;
   P.boundary_conditions[1][2] = REFLECTIVE; // x+
@@ -279,6 +618,302 @@ Parameters read_CLI(int argc, char * argv[])
       else
         print_CLI_error();
     }
+    // transport sweep type
+    else if( strcmp(arg, "--sweep") == 0 )
+    {
+      char * type;
+      if( ++i < argc )
+        type = argv[i];
+      else
+        print_CLI_error();
+
+      if( strcmp(type, "two-phase") == 0 )
+        P.sweep_type = TWO_PHASE_SWEEP;
+      else if( strcmp(type, "fused") == 0 )
+        P.sweep_type = FUSED_SWEEP;
+      else
+        print_CLI_error();
+    }
+    // ray tracing method
+    else if( strcmp(arg, "--tracer") == 0 )
+    {
+      char * method;
+      if( ++i < argc )
+        method = argv[i];
+      else
+        print_CLI_error();
+
+      if( strcmp(method, "dda") == 0 )
+        P.ray_trace_method = DDA_RAY_TRACE;
+      else if( strcmp(method, "legacy") == 0 )
+        P.ray_trace_method = LEGACY_RAY_TRACE;
+      else
+        print_CLI_error();
+    }
+    // flux attenuation kernel type
+    else if( strcmp(arg, "--attenuation") == 0 )
+    {
+      char * type;
+      if( ++i < argc )
+        type = argv[i];
+      else
+        print_CLI_error();
+
+      if( strcmp(type, "vector") == 0 )
+        P.attenuation_type = VECTOR_ATTENUATION;
+      else if( strcmp(type, "scalar") == 0 )
+        P.attenuation_type = SCALAR_ATTENUATION;
+      else
+        print_CLI_error();
+    }
+    // source approximation
+    else if( strcmp(arg, "--source") == 0 )
+    {
+      char * type;
+      if( ++i < argc )
+        type = argv[i];
+      else
+        print_CLI_error();
+
+      if( strcmp(type, "flat") == 0 )
+        P.source_type = FLAT_SOURCE;
+      else if( strcmp(type, "linear") == 0 )
+        P.source_type = LINEAR_SOURCE;
+      else
+        print_CLI_error();
+    }
+    // cell update passes
+    else if( strcmp(arg, "--cell-update") == 0 )
+    {
+      char * type;
+      if( ++i < argc )
+        type = argv[i];
+      else
+        print_CLI_error();
+
+      if( strcmp(type, "fused") == 0 )
+        P.cell_update_type = FUSED_CELL_UPDATE;
+      else if( strcmp(type, "separate") == 0 )
+        P.cell_update_type = SEPARATE_CELL_UPDATE;
+      else
+        print_CLI_error();
+    }
+    // source update
+    else if( strcmp(arg, "--source-update") == 0 )
+    {
+      char * type;
+      if( ++i < argc )
+        type = argv[i];
+      else
+        print_CLI_error();
+
+      if( strcmp(type, "blocked") == 0 )
+        P.source_update_type = BLOCKED_SOURCE_UPDATE;
+      else if( strcmp(type, "cell") == 0 )
+        P.source_update_type = CELL_SOURCE_UPDATE;
+      else
+        print_CLI_error();
+    }
+    // scalar flux tally strategy
+    else if( strcmp(arg, "--tally") == 0 )
+    {
+      char * type;
+      if( ++i < argc )
+        type = argv[i];
+      else
+        print_CLI_error();
+
+      if( strcmp(type, "atomic") == 0 )
+        P.tally_type = ATOMIC_TALLY;
+      else if( strcmp(type, "private") == 0 )
+        P.tally_type = PRIVATE_TALLY;
+      else
+        print_CLI_error();
+    }
+    // two-phase sweep segment storage
+    else if( strcmp(arg, "--segments") == 0 )
+    {
+      char * type;
+      if( ++i < argc )
+        type = argv[i];
+      else
+        print_CLI_error();
+
+      if( strcmp(type, "compact") == 0 )
+        P.segment_store_type = COMPACT_SEGMENTS;
+      else if( strcmp(type, "padded") == 0 )
+        P.segment_store_type = PADDED_SEGMENTS;
+      else
+        print_CLI_error();
+    }
+    // ray sorting interval
+    else if( strcmp(arg, "--sort-interval") == 0 )
+    {
+      if( ++i < argc )
+        P.ray_sort_interval = atoi(argv[i]);
+      else
+        print_CLI_error();
+    }
+    // cell numbering
+    else if( strcmp(arg, "--cell-order") == 0 )
+    {
+      char * type;
+      if( ++i < argc )
+        type = argv[i];
+      else
+        print_CLI_error();
+
+      if( strcmp(type, "row-major") == 0 )
+        P.cell_order = ROW_MAJOR_CELLS;
+      else if( strcmp(type, "morton") == 0 )
+        P.cell_order = MORTON_CELLS;
+      else
+        print_CLI_error();
+    }
+    // CMFD acceleration
+    else if( strcmp(arg, "--cmfd") == 0 )
+    {
+      char * type;
+      if( ++i < argc )
+        type = argv[i];
+      else
+        print_CLI_error();
+
+      if( strcmp(type, "none") == 0 )
+        P.cmfd_type = NO_CMFD;
+      else if( strcmp(type, "pin") == 0 )
+        P.cmfd_type = PIN_CMFD;
+      else
+        print_CLI_error();
+    }
+    // automatic inactive iterations
+    else if( strcmp(arg, "--auto-inactive") == 0 )
+    {
+      P.auto_inactive_enabled = 1;
+    }
+    // k-eff precision target
+    else if( strcmp(arg, "--target-k-std-dev") == 0 )
+    {
+      if( ++i < argc )
+        P.target_k_eff_std_dev = atof(argv[i]);
+      else
+        print_CLI_error();
+    }
+    // flux precision target
+    else if( strcmp(arg, "--target-flux-error") == 0 )
+    {
+      if( ++i < argc )
+        P.target_flux_relative_error = atof(argv[i]);
+      else
+        print_CLI_error();
+    }
+    // mesh sequence
+    else if( strcmp(arg, "--mesh-sequence") == 0 )
+    {
+      char * list;
+      if( ++i < argc )
+        list = argv[i];
+      else
+        print_CLI_error();
+
+      P.n_coarse_mesh_levels = 0;
+      for( char * token = strtok(list, ","); token != NULL; token = strtok(NULL, ",") )
+      {
+        if( P.n_coarse_mesh_levels == MAX_COARSE_MESH_LEVELS )
+          print_CLI_error();
+        P.coarse_mesh_multipliers[P.n_coarse_mesh_levels++] = atoi(token);
+      }
+    }
+    // inactive iterations on the finer meshes of a mesh sequence
+    else if( strcmp(arg, "--mesh-sequence-fine-inactive") == 0 )
+    {
+      if( ++i < argc )
+        P.n_fine_inactive_iterations = atoi(argv[i]);
+      else
+        print_CLI_error();
+    }
+    // checkpoint file
+    else if( strcmp(arg, "--checkpoint") == 0 )
+    {
+      if( ++i < argc )
+        P.checkpoint_file = argv[i];
+      else
+        print_CLI_error();
+    }
+    // checkpoint interval
+    else if( strcmp(arg, "--checkpoint-interval") == 0 )
+    {
+      if( ++i < argc )
+        P.checkpoint_interval = atoi(argv[i]);
+      else
+        print_CLI_error();
+    }
+    // restart from checkpoint
+    else if( strcmp(arg, "--restart") == 0 )
+    {
+      if( ++i < argc )
+        P.restart_file = argv[i];
+      else
+        print_CLI_error();
+    }
+    // material map source
+    else if( strcmp(arg, "--geometry") == 0 )
+    {
+      char * type;
+      if( ++i < argc )
+        type = argv[i];
+      else
+        print_CLI_error();
+
+      if( strcmp(type, "procedural") == 0 )
+        P.geometry_source = PROCEDURAL_GEOMETRY;
+      else if( strcmp(type, "file") == 0 )
+        P.geometry_source = FILE_GEOMETRY;
+      else
+        print_CLI_error();
+    }
+    // machine-readable summary
+    else if( strcmp(arg, "--summary") == 0 )
+    {
+      if( ++i < argc )
+        P.summary_file = argv[i];
+      else
+        print_CLI_error();
+    }
+    // hardware performance counters
+    else if( strcmp(arg, "--perf-counters") == 0 )
+    {
+      P.perf_counters_enabled = 1;
+    }
+    // pin power comparison against the reference
+    else if( strcmp(arg, "--pin-powers") == 0 )
+    {
+      P.pin_powers_enabled = 1;
+    }
+    // text data directory
+    else if( strcmp(arg, "--data-dir") == 0 )
+    {
+      if( ++i < argc )
+        P.data_directory = argv[i];
+      else
+        print_CLI_error();
+    }
+    // binary problem file
+    else if( strcmp(arg, "--problem") == 0 )
+    {
+      if( ++i < argc )
+        P.problem_file = argv[i];
+      else
+        print_CLI_error();
+    }
+    // binary problem file conversion
+    else if( strcmp(arg, "--write-problem") == 0 )
+    {
+      if( ++i < argc )
+        P.output_problem_file = argv[i];
+      else
+        print_CLI_error();
+    }
     else
       print_CLI_error();
   }
@@ -305,23 +940,105 @@ Parameters read_CLI(int argc, char * argv[])
     P.seed = 123456789;
   }
 
+  // The coarsest level of a mesh sequence runs the full inactive phase, while the
+  // finer levels (including the final mesh) only run a short one
+  if( P.n_coarse_mesh_levels > 0 )
+  {
+    int previous_multiplier = 0;
+    for( int level = 0; level <= P.n_coarse_mesh_levels; level++ )
+    {
+      int multiplier = (level < P.n_coarse_mesh_levels) ? P.coarse_mesh_multipliers[level] : problem_size_multiplier;
+      if( multiplier <= previous_multiplier || (previous_multiplier > 0 && multiplier % previous_multiplier != 0) )
+      {
+        printf("ERROR: Each mesh sequence multiplier must be a multiple of the previous one, with -m the finest\n");
+        exit(1);
+      }
+      previous_multiplier = multiplier;
+    }
+    if( P.problem_file != NULL )
+    {
+      printf("ERROR: A binary problem file fixes the mesh, so cannot be used with a mesh sequence\n");
+      exit(1);
+    }
+    P.n_coarse_inactive_iterations = P.n_inactive_iterations;
+    if( P.n_fine_inactive_iterations < 0 )
+      P.n_fine_inactive_iterations = (P.n_inactive_iterations < MESH_SEQUENCE_INACTIVE_ITERATIONS) ? P.n_inactive_iterations : MESH_SEQUENCE_INACTIVE_ITERATIONS;
+    P.n_inactive_iterations = P.n_fine_inactive_iterations;
+  }
+
+  // Stored segments do not record where they lie within their cell, so the
+  // linear source is only attenuated by the fused sweep
+  if( P.source_type == LINEAR_SOURCE && P.sweep_type != FUSED_SWEEP )
+  {
+    printf("ERROR: The linear source requires the fused transport sweep (--sweep fused)\n");
+    exit(1);
+  }
+
+  // Pin powers are computed from the active iteration flux tallies
+  if( P.pin_powers_enabled && P.n_active_iterations == 0 )
+  {
+    printf("ERROR: Pin powers require active iterations (-a)\n");
+    exit(1);
+  }
+
   // Derived Values
-  P.n_cells_per_dimension = 102 * problem_size_multiplier;
-  P.max_intersections_per_ray = 30 * problem_size_multiplier;
   if( !has_user_set_rays)
-    P.n_rays = 6170.0 * problem_size_multiplier + 1955.0;
-  P.cell_width = P.length_per_dimension / P.n_cells_per_dimension;
-  P.inverse_cell_width = 1.0 / P.cell_width;
-  P.n_cells = P.n_cells_per_dimension * P.n_cells_per_dimension;
-  P.cell_expected_track_length = (P.distance_per_ray * P.n_rays) / P.n_cells;
-  P.inverse_total_track_length = 1.0 / (P.distance_per_ray * P.n_rays);
+    P.n_rays = get_default_n_rays(problem_size_multiplier);
+  set_problem_size(&P, problem_size_multiplier);
   P.inverse_length_per_dimension = 1.0 / P.length_per_dimension;
   P.n_iterations = P.n_inactive_iterations + P.n_active_iterations;
-  P.cell_volume = 1.0 / P.n_cells;
+  P.n_energy_groups_padded = ((P.n_energy_groups + SIMD_WIDTH - 1) / SIMD_WIDTH) * SIMD_WIDTH;
+  P.n_flux_gradient_entries = 2 * P.n_energy_groups + N_TRACK_MOMENTS;
+  P.specialized_group_count = get_specialized_group_count(P.n_energy_groups);
+
+  // The C5G7 core is 3 x 3 assemblies of 17 x 17 pins
+  if( P.cmfd_type == PIN_CMFD )
+    P.n_cmfd_cells_per_dimension = 51;
+  else
+    P.n_cmfd_cells_per_dimension = 0;
 
   return P;
 }
 
+// Returns the group count if the kernels have a specialized copy for it (see
+// group_specialization.h), or 0 if the generic kernels must be used
+int get_specialized_group_count(int n_energy_groups)
+{
+  int specialized_group_counts[] = {2, 4, 7, 8, 70};
+  for( int i = 0; i < (int) (sizeof(specialized_group_counts) / sizeof(int)); i++ )
+    if( n_energy_groups == specialized_group_counts[i] )
+      return n_energy_groups;
+  return 0;
+}
+
+uint64_t get_default_n_rays(int problem_size_multiplier)
+{
+  return 6170.0 * problem_size_multiplier + 1955.0;
+}
+
+// Sets all values that depend on the mesh resolution (n_rays must already be set)
+void set_problem_size(Parameters * P, int problem_size_multiplier)
+{
+  P->problem_size_multiplier = problem_size_multiplier;
+  P->n_cells_per_dimension = 102 * problem_size_multiplier;
+  P->max_intersections_per_ray = 30 * problem_size_multiplier;
+  P->cell_width = P->length_per_dimension / P->n_cells_per_dimension;
+  P->inverse_cell_width = 1.0 / P->cell_width;
+  P->n_cells = P->n_cells_per_dimension * P->n_cells_per_dimension;
+  P->cell_expected_track_length = (P->distance_per_ray * P->n_rays) / P->n_cells;
+  P->inverse_total_track_length = 1.0 / (P->distance_per_ray * P->n_rays);
+  P->cell_volume = 1.0 / P->n_cells;
+  initialize_cell_order(P);
+}
+
+// Opens a text data file from the C5G7 data directory
+FILE * open_data_file(Parameters P, const char * name)
+{
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/%s", P.data_directory, name);
+  return fopen(path, "r");
+}
+
 // KEY
 // 0 - UO2
 // 1 - MOX 4.3
@@ -345,55 +1062,55 @@ ReadOnlyData load_2D_C5G7_XS(Parameters P)
   float * Sigma_s =     (float *) calloc(sz, sizeof(float));
 
   // UO2 fuel-clad mixture
-  FILE * UO2_scatter   = fopen("../data/C5G7_2D/UO2_scatter.txt",   "r");
-  FILE * UO2_transport = fopen("../data/C5G7_2D/UO2_transport.txt", "r");
-  FILE * UO2_nufission = fopen("../data/C5G7_2D/UO2_nufission.txt", "r");
-  FILE * UO2_fission   = fopen("../data/C5G7_2D/UO2_fission.txt", "r");
-  FILE * UO2_chi       = fopen("../data/C5G7_2D/UO2_chi.txt", "r");
+  FILE * UO2_scatter   = open_data_file(P, "UO2_scatter.txt");
+  FILE * UO2_transport = open_data_file(P, "UO2_transport.txt");
+  FILE * UO2_nufission = open_data_file(P, "UO2_nufission.txt");
+  FILE * UO2_fission   = open_data_file(P, "UO2_fission.txt");
+  FILE * UO2_chi       = open_data_file(P, "UO2_chi.txt");
 
   // MOX 4.3% fuel-clad mixture
-  FILE * MOX_43_scatter   = fopen("../data/C5G7_2D/MOX_43_scatter.txt",   "r");
-  FILE * MOX_43_transport = fopen("../data/C5G7_2D/MOX_43_transport.txt", "r");
-  FILE * MOX_43_nufission = fopen("../data/C5G7_2D/MOX_43_nufission.txt", "r");
-  FILE * MOX_43_fission   = fopen("../data/C5G7_2D/MOX_43_fission.txt", "r");
-  FILE * MOX_43_chi       = fopen("../data/C5G7_2D/MOX_43_chi.txt", "r");
+  FILE * MOX_43_scatter   = open_data_file(P, "MOX_43_scatter.txt");
+  FILE * MOX_43_transport = open_data_file(P, "MOX_43_transport.txt");
+  FILE * MOX_43_nufission = open_data_file(P, "MOX_43_nufission.txt");
+  FILE * MOX_43_fission   = open_data_file(P, "MOX_43_fission.txt");
+  FILE * MOX_43_chi       = open_data_file(P, "MOX_43_chi.txt");
 
   // MOX 7.0% fuel-clad mixture
-  FILE * MOX_70_scatter   = fopen("../data/C5G7_2D/MOX_70_scatter.txt",   "r");
-  FILE * MOX_70_transport = fopen("../data/C5G7_2D/MOX_70_transport.txt", "r");
-  FILE * MOX_70_nufission = fopen("../data/C5G7_2D/MOX_70_nufission.txt", "r");
-  FILE * MOX_70_fission   = fopen("../data/C5G7_2D/MOX_70_fission.txt", "r");
-  FILE * MOX_70_chi       = fopen("../data/C5G7_2D/MOX_70_chi.txt", "r");
+  FILE * MOX_70_scatter   = open_data_file(P, "MOX_70_scatter.txt");
+  FILE * MOX_70_transport = open_data_file(P, "MOX_70_transport.txt");
+  FILE * MOX_70_nufission = open_data_file(P, "MOX_70_nufission.txt");
+  FILE * MOX_70_fission   = open_data_file(P, "MOX_70_fission.txt");
+  FILE * MOX_70_chi       = open_data_file(P, "MOX_70_chi.txt");
 
   // MOX 8.7% fuel-clad mixture
-  FILE * MOX_87_scatter   = fopen("../data/C5G7_2D/MOX_87_scatter.txt",   "r");
-  FILE * MOX_87_transport = fopen("../data/C5G7_2D/MOX_87_transport.txt", "r");
-  FILE * MOX_87_nufission = fopen("../data/C5G7_2D/MOX_87_nufission.txt", "r");
-  FILE * MOX_87_fission   = fopen("../data/C5G7_2D/MOX_87_fission.txt", "r");
-  FILE * MOX_87_chi       = fopen("../data/C5G7_2D/MOX_87_chi.txt", "r");
+  FILE * MOX_87_scatter   = open_data_file(P, "MOX_87_scatter.txt");
+  FILE * MOX_87_transport = open_data_file(P, "MOX_87_transport.txt");
+  FILE * MOX_87_nufission = open_data_file(P, "MOX_87_nufission.txt");
+  FILE * MOX_87_fission   = open_data_file(P, "MOX_87_fission.txt");
+  FILE * MOX_87_chi       = open_data_file(P, "MOX_87_chi.txt");
 
   // Fission Chamber
-  FILE * FC_scatter   = fopen("../data/C5G7_2D/FC_scatter.txt",   "r");
-  FILE * FC_transport = fopen("../data/C5G7_2D/FC_transport.txt", "r");
-  FILE * FC_nufission = fopen("../data/C5G7_2D/FC_nufission.txt", "r");
-  FILE * FC_fission   = fopen("../data/C5G7_2D/FC_fission.txt", "r");
-  FILE * FC_chi       = fopen("../data/C5G7_2D/FC_chi.txt", "r");
+  FILE * FC_scatter   = open_data_file(P, "FC_scatter.txt");
+  FILE * FC_transport = open_data_file(P, "FC_transport.txt");
+  FILE * FC_nufission = open_data_file(P, "FC_nufission.txt");
+  FILE * FC_fission   = open_data_file(P, "FC_fission.txt");
+  FILE * FC_chi       = open_data_file(P, "FC_chi.txt");
 
   // Guide Tube
-  FILE * GT_scatter   = fopen("../data/C5G7_2D/GT_scatter.txt",   "r");
-  FILE * GT_transport = fopen("../data/C5G7_2D/GT_transport.txt", "r");
+  FILE * GT_scatter   = open_data_file(P, "GT_scatter.txt");
+  FILE * GT_transport = open_data_file(P, "GT_transport.txt");
 
   // Moderator
-  FILE * Mod_scatter   = fopen("../data/C5G7_2D/Mod_scatter.txt",   "r");
-  FILE * Mod_transport = fopen("../data/C5G7_2D/Mod_transport.txt", "r");
+  FILE * Mod_scatter   = open_data_file(P, "Mod_scatter.txt");
+  FILE * Mod_transport = open_data_file(P, "Mod_transport.txt");
 
   // Control Rod
-  FILE * CR_scatter   = fopen("../data/C5G7_2D/CR_scatter.txt",   "r");
-  FILE * CR_transport = fopen("../data/C5G7_2D/CR_transport.txt", "r");
+  FILE * CR_scatter   = open_data_file(P, "CR_scatter.txt");
+  FILE * CR_transport = open_data_file(P, "CR_transport.txt");
   
   if( CR_transport == NULL )
   {
-    printf("Cross section data files not found at ../data/C5G7_2D/\n");
+    printf("Cross section data files not found at %s/\n", P.data_directory);
     exit(1);
   }
 
@@ -479,26 +1196,15 @@ ReadOnlyData load_2D_C5G7_XS(Parameters P)
   fclose(CR_scatter      );
   fclose(CR_transport    );
 
-  char fname[512];
-  sprintf(fname, "../data/C5G7_2D/material_ids_%d.txt", P.n_cells_per_dimension);
-  printf("Searching for material data file \"%s\"...\n", fname); 
-  FILE * material_file = fopen(fname, "r");
-  if( material_file == NULL )
-  {
-    printf("Material data file not found for dimension %d. Generate new data file with ARRC,\nor use a dimension or multipiler with existing data file.\nCurrently supported multipliers \"-m <1, 2, 4, 8, 16, 32>\"\n", P.n_cells_per_dimension);
-    exit(1);
-  }
+  int * material_id;
+  if( P.geometry_source == FILE_GEOMETRY )
+    material_id = load_2D_C5G7_material_ids(P);
   else
-    printf("Material data file found.\n");
-  sz = P.n_cells * sizeof(int);
-  int * material_id = (int *) malloc(sz);
-  for( int c = 0; c < P.n_cells; c++ )
   {
-    ret = fscanf(material_file, "%d", material_id + c);
+    printf("Generating C5G7 material map...\n");
+    material_id = generate_2D_C5G7_material_ids(P);
   }
 
-  fclose(material_file);
-
   ReadOnlyData ROD;
   ROD.Sigma_f = Sigma_f;
   ROD.Sigma_t = Sigma_t;
@@ -506,6 +1212,8 @@ ReadOnlyData load_2D_C5G7_XS(Parameters P)
   ROD.nu_Sigma_f = nu_Sigma_f;
   ROD.Chi = Chi;
   ROD.material_id = material_id;
+  ROD.problem_file_mapping = NULL;
+  ROD.problem_file_mapping_size = 0;
 
   if( ret == 0 )
   {
@@ -516,6 +1224,39 @@ ReadOnlyData load_2D_C5G7_XS(Parameters P)
   return ROD;
 }
 
+int * load_2D_C5G7_material_ids(Parameters P)
+{
+  char fname[512];
+  sprintf(fname, "material_ids_%d.txt", P.n_cells_per_dimension);
+  printf("Searching for material data file \"%s/%s\"...\n", P.data_directory, fname); 
+  FILE * material_file = open_data_file(P, fname);
+  if( material_file == NULL )
+  {
+    printf("Material data file not found for dimension %d. Use \"--geometry procedural\", or a multiplier\nwith an existing data file. Currently supported multipliers \"-m <1, 2, 4, 8>\"\n", P.n_cells_per_dimension);
+    exit(1);
+  }
+  else
+    printf("Material data file found.\n");
+  size_t sz = P.n_cells * sizeof(int);
+  int * material_id = (int *) malloc(sz);
+  int ret = 0;
+  // The file is stored in row-major order, so is permuted into the cell numbering in use
+  for( int c = 0; c < P.n_cells; c++ )
+  {
+    ret = fscanf(material_file, "%d", material_id + get_cell_id(P, c % P.n_cells_per_dimension, c / P.n_cells_per_dimension));
+  }
+
+  fclose(material_file);
+
+  if( ret != 1 )
+  {
+    printf("something went wrong with material data read in...\n");
+    exit(1);
+  }
+
+  return material_id;
+}
+
 float eswap_float( float f )
 {    
   char * ptr = (char *) &f;
@@ -552,7 +1293,7 @@ int eswap_int( int f )
   return f;
 }
 
-void plot_3D_vtk(Parameters P, float * scalar_flux_accumulator, int * material_id)
+void plot_3D_vtk(Parameters P, float * scalar_flux_accumulator, int * material_id, int n_active_iterations)
 {
   center_print("PLOT GENERATION", 79);
   border_print();
@@ -595,15 +1336,14 @@ void plot_3D_vtk(Parameters P, float * scalar_flux_accumulator, int * material_i
     fprintf(fp, "SCALARS thermal_flux float\n");
     fprintf(fp, "LOOKUP_TABLE default\n");
 
-    int cell_id = 0;
     for( int y = 0; y < P.n_cells_per_dimension; y++)
     {
       for( int x = 0; x < P.n_cells_per_dimension; x++)
       {
-        float thermal_flux = scalar_flux_accumulator[cell_id * P.n_energy_groups +P.n_energy_groups - 1] / P.n_active_iterations;
+        int cell_id = get_cell_id(P, x, y);
+        float thermal_flux = scalar_flux_accumulator[cell_id * P.n_energy_groups +P.n_energy_groups - 1] / n_active_iterations;
         thermal_flux = eswap_float(thermal_flux);
         fwrite(&thermal_flux, sizeof(float), 1, fp);
-        cell_id++;
       }
     }
   }
@@ -613,15 +1353,14 @@ void plot_3D_vtk(Parameters P, float * scalar_flux_accumulator, int * material_i
     fprintf(fp, "SCALARS fast_flux float\n");
     fprintf(fp, "LOOKUP_TABLE default\n");
 
-    int cell_id = 0;
     for( int y = 0; y < P.n_cells_per_dimension; y++)
     {
       for( int x = 0; x < P.n_cells_per_dimension; x++)
       {
-        float fast_flux = scalar_flux_accumulator[cell_id * P.n_energy_groups] / P.n_active_iterations;
+        int cell_id = get_cell_id(P, x, y);
+        float fast_flux = scalar_flux_accumulator[cell_id * P.n_energy_groups] / n_active_iterations;
         fast_flux = eswap_float(fast_flux);
         fwrite(&fast_flux, sizeof(float), 1, fp);
-        cell_id++;
       }
     }
   }
@@ -630,12 +1369,11 @@ void plot_3D_vtk(Parameters P, float * scalar_flux_accumulator, int * material_i
   {
     fprintf(fp, "SCALARS material_type int\n");
     fprintf(fp, "LOOKUP_TABLE default\n");
-    int cell_id = 0;
     for( int y = 0; y < P.n_cells_per_dimension; y++)
     {
       for( int x = 0; x < P.n_cells_per_dimension; x++)
       {
-        int material = material_id[cell_id++];
+        int material = material_id[get_cell_id(P, x, y)];
         material = eswap_int(material);
         fwrite(&material, sizeof(int), 1, fp);
       }
@@ -655,8 +1393,8 @@ void print_ray_tracing_buffer(Parameters P, SimulationData SD)
     printf("Ray %d had %d intersections, and is now at location [%.2lf, %.2lf] with group 0 flux %.3le\n", r, ID.n_intersections[r], SD.readWriteData.rayData.location_x[r], SD.readWriteData.rayData.location_y[r], SD.readWriteData.rayData.angular_flux[r * P.n_energy_groups]);
     for( int i = 0; i < ID.n_intersections[r]; i++ )
     {
-      int idx = r * P.max_intersections_per_ray + i;
-      printf("\tIntersection %d:   cell_id: %d   distance: %.2le   vac reflect: %d\n", i, ID.cell_ids[idx], ID.distances[idx], ID.did_vacuum_reflects[idx]);
+      Segment segment = load_stored_segment(P, ID, get_ray_segment_offset(P, ID, r) + i);
+      printf("\tIntersection %d:   cell_id: %d   distance: %.2le   vac reflect: %d\n", i, segment.cell_id, segment.distance, segment.did_vacuum_reflect);
     }
   }
 }
@@ -666,12 +1404,11 @@ void output_thermal_fluxes(Parameters P, SimulationData SD)
   char * fname = "thermal_fluxes.dat";
   printf("Writing thermal flux data to file: \"%s\"...\n", fname);
   FILE * fp = fopen(fname, "w");
-  int cell_id = 0;
   for( int y = 0; y < P.n_cells_per_dimension; y++)
   {
     for( int x = 0; x < P.n_cells_per_dimension; x++)
     {
-      fprintf(fp, "%.3le ", SD.readWriteData.cellData.scalar_flux_accumulator[cell_id++] / P.n_active_iterations);
+      fprintf(fp, "%.3le ", SD.readWriteData.cellData.scalar_flux_accumulator[get_cell_id(P, x, y)] / P.n_active_iterations);
     }
     fprintf(fp, "\n");
   }
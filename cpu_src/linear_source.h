@@ -0,0 +1,100 @@
+// Linear source attenuation. Rather than a flat source in each cell, the source
+// varies linearly over the cell about its center r_c,
+//
+//   q(r) = q + grad(q) . ( r - r_c )
+//
+// so that along a segment of length l starting at r_0 in direction u, the source
+// is q_mid + q_dir * ( s - l/2 ), with q_mid the source at the segment midpoint,
+// and q_dir = grad(q) . u. The angular flux is attenuated exactly for this source,
+// and the segment's contribution to the cell's flux moments,
+//
+//   int ( r(s) - r_c ) psi(s) ds = ( r_0 - r_c ) * int psi(s) ds + u * int s psi(s) ds,
+//
+// is tallied alongside the usual change in angular flux, as are the moments of the
+// segment itself (see compute_flux_gradient_kernel). These give the flux gradients,
+// and therefore the source gradients, of the next iteration (see
+// update_isotropic_sources_kernel). As all isotropic sources here are divided by
+// Sigma_t, so are the source gradients.
+//
+// The group loop is split in three, as in attenuate_segment_groups: the
+// exponentials (a libm call per group), then the attenuation itself, which is
+// vectorized across groups, and then the tallies. It is specialized on the
+// group count G along with the fused sweep it is inlined into.
+//
+// The ray state must be that at the start of the segment (i.e., before it was traced).
+SPECIALIZED_INLINE void attenuate_segment_linear_source(Parameters P, SimulationData SD, const int G, int thread_id, float * restrict angular_flux, RayState ray, Segment segment)
+{
+  uint64_t cell_id = segment.cell_id;
+  const float * Sigma_t = SD.readOnlyData.Sigma_t + SD.readOnlyData.material_id[cell_id] * G;
+  const float * isotropic_source = SD.readWriteData.cellData.isotropic_source + cell_id * G;
+  const float * source_gradient = SD.readWriteData.cellData.source_gradient + cell_id * G * 2;
+
+  double distance = segment.distance;
+
+  // Segment start and midpoint, relative to the cell center
+  double start_x = ray.x - (ray.x_idx + 0.5) * P.cell_width;
+  double start_y = ray.y - (ray.y_idx + 0.5) * P.cell_width;
+  double midpoint_x = start_x + ray.x_dir * 0.5 * distance;
+  double midpoint_y = start_y + ray.y_dir * 0.5 * distance;
+
+  // Exponential terms ( exponential = 1 - exp( -tau ) ), which need a libm call
+  // and a branch per group, so are found before the vectorized loop
+  double exponential[G];
+  double G1[G];
+  double G2[G];
+  for( int energy_group = 0; energy_group < G; energy_group++ )
+  {
+    double tau = Sigma_t[energy_group] * distance;
+    exponential[energy_group] = -expm1(-tau);
+    G1[energy_group] = exponential_G(tau, exponential[energy_group]);
+    G2[energy_group] = exponential_G2(tau, G1[energy_group]);
+  }
+
+  double delta_psi[G];
+  double moment_x[G];
+  double moment_y[G];
+
+  #pragma omp simd
+  for( int energy_group = 0; energy_group < G; energy_group++ )
+  {
+    double sigma_t = Sigma_t[energy_group];
+    double tau = sigma_t * distance;
+    double psi = angular_flux[energy_group];
+
+    double q_mid = isotropic_source[energy_group] + source_gradient[energy_group * 2] * midpoint_x + source_gradient[energy_group * 2 + 1] * midpoint_y;
+    double q_dir = source_gradient[energy_group * 2] * ray.x_dir + source_gradient[energy_group * 2 + 1] * ray.y_dir;
+
+    double delta = (psi - q_mid) * exponential[energy_group] - q_dir * distance * tau * (G1[energy_group] * (1.0 + 0.5 * tau) - 0.5);
+
+    // Integrals of the angular flux, and of s times the angular flux, over the segment
+    double integral_psi = q_mid * distance + delta / sigma_t;
+    double h = 1.0 - (1.0 + tau) * G1[energy_group];
+    double integral_s_psi = distance * distance * (h * psi + (0.5 - h) * q_mid + 0.5 * G2[energy_group] * q_dir * distance);
+
+    delta_psi[energy_group] = delta;
+    moment_x[energy_group] = start_x * integral_psi + ray.x_dir * integral_s_psi;
+    moment_y[energy_group] = start_y * integral_psi + ray.y_dir * integral_s_psi;
+
+    angular_flux[energy_group] = psi - delta;
+  }
+
+  float * tally = get_scalar_flux_tally(P, SD, thread_id, cell_id);
+  float * moments_tally = get_flux_moments_tally(P, SD, thread_id, cell_id);
+
+  // Track length, and its first and second moments about the cell center
+  float * track_moments_tally = moments_tally + 2 * G;
+  double second_moment = distance * distance / 12.0;
+  tally_scalar_flux(P, track_moments_tally,     distance);
+  tally_scalar_flux(P, track_moments_tally + 1, distance * midpoint_x);
+  tally_scalar_flux(P, track_moments_tally + 2, distance * midpoint_y);
+  tally_scalar_flux(P, track_moments_tally + 3, distance * (midpoint_x * midpoint_x + ray.x_dir * ray.x_dir * second_moment));
+  tally_scalar_flux(P, track_moments_tally + 4, distance * (midpoint_x * midpoint_y + ray.x_dir * ray.y_dir * second_moment));
+  tally_scalar_flux(P, track_moments_tally + 5, distance * (midpoint_y * midpoint_y + ray.y_dir * ray.y_dir * second_moment));
+
+  for( int energy_group = 0; energy_group < G; energy_group++ )
+  {
+    tally_scalar_flux(P, tally + energy_group, delta_psi[energy_group]);
+    tally_scalar_flux(P, moments_tally + energy_group * 2,     moment_x[energy_group]);
+    tally_scalar_flux(P, moments_tally + energy_group * 2 + 1, moment_y[energy_group]);
+  }
+}
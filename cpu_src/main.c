@@ -8,22 +8,49 @@ int main(int argc, char * argv[])
   // Display inputs and derived inputs
   print_user_inputs(P);
 
+  // Convert the text problem data into a binary problem file, if requested
+  if( P.output_problem_file != NULL )
+    return convert_problem_file(P);
+
   // Allocate all data required by simulation
   SimulationData SD = initialize_simulation(P);
 
+  // Read the reference pin powers before the run, so that a missing file is found early
+  double * reference_pin_power = NULL;
+  if( P.pin_powers_enabled )
+    reference_pin_power = read_reference_pin_powers(P);
+
   // Populate simulation data with starting guesses
   initialize_rays(P, SD);
   initialize_fluxes(P, SD);
 
+  // Converge the fission source on a sequence of coarser meshes first, if enabled
+  double k_eff = 1.0;
+  double runtime_mesh_sequence = 0.0;
+  if( P.n_coarse_mesh_levels > 0 && P.restart_file == NULL )
+    k_eff = run_mesh_sequence(P, SD, &runtime_mesh_sequence);
+
   // Run Random Ray Simulation
-  SimulationResult SR = run_simulation(P, SD);
+  center_print("SIMULATION", 79);
+  border_print();
+  SimulationResult SR = run_simulation(P, SD, k_eff);
+  SR.runtime_mesh_sequence = runtime_mesh_sequence;
+  if( P.pin_powers_enabled )
+  {
+    compare_pin_powers(P, SD, reference_pin_power, &SR.pin_power_rms_error, &SR.pin_power_max_error);
+    free(reference_pin_power);
+  }
 
   // Display Results
   int is_valid_result = print_results(P, SR);
 
+  // Output machine-readable summary if enabled
+  if(P.summary_file != NULL)
+    write_summary(P, SR, is_valid_result);
+
   // Output VTK plotting file if enabled
   if(P.plotting_enabled)
-    plot_3D_vtk(P, SD.readWriteData.cellData.scalar_flux_accumulator, SD.readOnlyData.material_id);
+    plot_3D_vtk(P, SD.readWriteData.cellData.scalar_flux_accumulator, SD.readOnlyData.material_id, SR.n_active_iterations);
 
   return is_valid_result;
 }
@@ -0,0 +1,154 @@
+#include "minray.h"
+#include "cell_order.h"
+
+// Mesh sequencing. On a fine mesh, most of the inactive iterations are spent
+// converging the global shape of the fission source, which a much coarser mesh
+// (with proportionally fewer rays) captures at a small fraction of the cost. The
+// inactive iterations are therefore first run on the coarsest mesh of the
+// sequence, and the solution is then prolonged onto each finer mesh in turn,
+// with a short inactive phase on each to relax the finer scale detail. As the
+// mesh multipliers are nested, each coarse cell is exactly covered by a block
+// of fine cells, which all take on its scalar flux. The rays keep their
+// positions, directions, and angular fluxes, while any extra rays needed by the
+// finer mesh are sampled afresh and start with the scalar flux of their cell.
+
+// Returns the parameters of the problem on one of the coarse meshes, which only
+// runs inactive iterations
+Parameters get_coarse_mesh_parameters(Parameters P, int level)
+{
+  Parameters coarse = P;
+  int multiplier = P.coarse_mesh_multipliers[level];
+  coarse.n_rays = get_default_n_rays(multiplier);
+  set_problem_size(&coarse, multiplier);
+
+  // Only the coarsest mesh runs the full (or automatic) inactive phase
+  coarse.n_coarse_mesh_levels = 0;
+  coarse.n_inactive_iterations = (level == 0) ? P.n_coarse_inactive_iterations : P.n_fine_inactive_iterations;
+  coarse.auto_inactive_enabled = (level == 0) ? P.auto_inactive_enabled : 0;
+  coarse.n_active_iterations = 0;
+  coarse.n_iterations = coarse.n_inactive_iterations;
+  coarse.target_k_eff_std_dev = 0.0;
+  coarse.target_flux_relative_error = 0.0;
+  coarse.perf_counters_enabled = 0;
+  coarse.checkpoint_file = NULL;
+  coarse.restart_file = NULL;
+
+  return coarse;
+}
+
+void prolong_scalar_flux(Parameters coarse, SimulationData coarse_SD, Parameters fine, SimulationData fine_SD)
+{
+  int ratio = fine.n_cells_per_dimension / coarse.n_cells_per_dimension;
+  int G = fine.n_energy_groups;
+
+  #pragma omp parallel for
+  for( int y = 0; y < fine.n_cells_per_dimension; y++ )
+  {
+    for( int x = 0; x < fine.n_cells_per_dimension; x++ )
+    {
+      float * coarse_flux = coarse_SD.readWriteData.cellData.old_scalar_flux + (uint64_t) get_cell_id(coarse, x / ratio, y / ratio) * G;
+      float * fine_flux   = fine_SD.readWriteData.cellData.old_scalar_flux   + (uint64_t) get_cell_id(fine, x, y) * G;
+      for( int energy_group = 0; energy_group < G; energy_group++ )
+        fine_flux[energy_group] = coarse_flux[energy_group];
+    }
+  }
+
+  // With the linear source, each fine cell starts flat (the coarse gradient is
+  // instead represented by the steps between the fine cells)
+  if( fine.source_type == LINEAR_SOURCE )
+    memset(fine_SD.readWriteData.cellData.old_flux_gradient, 0, fine.n_cells * fine.n_flux_gradient_entries * sizeof(float));
+
+  memset(fine_SD.readWriteData.cellData.scalar_flux_accumulator, 0, fine.n_cells * G * sizeof(float));
+  memset(fine_SD.readWriteData.cellData.scalar_flux_total, 0, fine.n_cells * G * sizeof(double));
+  if( fine_SD.readWriteData.cellData.scalar_flux_sum_of_squares_accumulator != NULL )
+    memset(fine_SD.readWriteData.cellData.scalar_flux_sum_of_squares_accumulator, 0, fine.n_cells * G * sizeof(float));
+}
+
+// Must follow prolong_scalar_flux, as new rays start with the fine scalar flux
+void prolong_rays(Parameters coarse, SimulationData coarse_SD, Parameters fine, SimulationData fine_SD)
+{
+  RayData coarse_RD = coarse_SD.readWriteData.rayData;
+  RayData fine_RD = fine_SD.readWriteData.rayData;
+  int ratio = fine.n_cells_per_dimension / coarse.n_cells_per_dimension;
+  int G = fine.n_energy_groups;
+
+  #pragma omp parallel for
+  for( int ray = 0; ray < fine.n_rays; ray++ )
+  {
+    if( ray >= coarse.n_rays )
+    {
+      initialize_ray_kernel(fine, fine.seed, ray, fine.length_per_dimension, fine.inverse_cell_width, fine_RD);
+      float * scalar_flux = fine_SD.readWriteData.cellData.old_scalar_flux + (uint64_t) fine_RD.cell_id[ray] * G;
+      for( int energy_group = 0; energy_group < G; energy_group++ )
+        fine_RD.angular_flux[(uint64_t) ray * G + energy_group] = scalar_flux[energy_group];
+      continue;
+    }
+
+    fine_RD.location_x[ray]  = coarse_RD.location_x[ray];
+    fine_RD.location_y[ray]  = coarse_RD.location_y[ray];
+    fine_RD.direction_x[ray] = coarse_RD.direction_x[ray];
+    fine_RD.direction_y[ray] = coarse_RD.direction_y[ray];
+    for( int energy_group = 0; energy_group < G; energy_group++ )
+      fine_RD.angular_flux[(uint64_t) ray * G + energy_group] = coarse_RD.angular_flux[(uint64_t) ray * G + energy_group];
+
+    // The fine cell is found from the ray's location, but kept within the block of
+    // its coarse cell in case the ray sits exactly on a cell (or problem) boundary
+    int coarse_cell_id = coarse_RD.cell_id[ray];
+    int x_min = get_cell_x_idx(coarse, coarse_cell_id) * ratio;
+    int y_min = get_cell_y_idx(coarse, coarse_cell_id) * ratio;
+    int x_idx = fine_RD.location_x[ray] * fine.inverse_cell_width;
+    int y_idx = fine_RD.location_y[ray] * fine.inverse_cell_width;
+    x_idx = (x_idx < x_min) ? x_min : (x_idx >= x_min + ratio) ? x_min + ratio - 1 : x_idx;
+    y_idx = (y_idx < y_min) ? y_min : (y_idx >= y_min + ratio) ? y_min + ratio - 1 : y_idx;
+    fine_RD.cell_id[ray] = get_cell_id(fine, x_idx, y_idx);
+  }
+}
+
+// Runs the inactive iterations on each coarse mesh in turn, and prolongs the
+// result onto the final mesh held in SD, in place of the flat starting guess of
+// initialize_fluxes. Returns the estimate of k-eff, and the time taken.
+double run_mesh_sequence(Parameters P, SimulationData SD, double * runtime)
+{
+  double start_time = get_time();
+  double k_eff = 1.0;
+  Parameters previous_P;
+  SimulationData previous_SD;
+
+  for( int level = 0; level < P.n_coarse_mesh_levels; level++ )
+  {
+    Parameters level_P = get_coarse_mesh_parameters(P, level);
+    SimulationData level_SD = initialize_simulation(level_P);
+
+    if( level == 0 )
+    {
+      initialize_rays(level_P, level_SD);
+      initialize_fluxes(level_P, level_SD);
+    }
+    else
+    {
+      prolong_scalar_flux(previous_P, previous_SD, level_P, level_SD);
+      prolong_rays(previous_P, previous_SD, level_P, level_SD);
+      free_simulation(previous_P, previous_SD);
+      free_cell_order(previous_P);
+    }
+
+    char title[128];
+    sprintf(title, "COARSE MESH SIMULATION (%d x %d cells, %lu rays)", level_P.n_cells_per_dimension, level_P.n_cells_per_dimension, level_P.n_rays);
+    center_print(title, 79);
+    border_print();
+
+    SimulationResult SR = run_simulation(level_P, level_SD, k_eff);
+    k_eff = SR.k_eff;
+
+    previous_P = level_P;
+    previous_SD = level_SD;
+  }
+
+  prolong_scalar_flux(previous_P, previous_SD, P, SD);
+  prolong_rays(previous_P, previous_SD, P, SD);
+  free_simulation(previous_P, previous_SD);
+  free_cell_order(previous_P);
+
+  *runtime = get_time() - start_time;
+  return k_eff;
+}
@@ -21,6 +21,124 @@
 
 #define BUMP 1.0e-11
 
+#define TWO_PHASE_SWEEP 0
+#define FUSED_SWEEP 1
+
+#define LEGACY_RAY_TRACE 0
+#define DDA_RAY_TRACE 1
+
+#define SCALAR_ATTENUATION 0
+#define VECTOR_ATTENUATION 1
+
+// Number of energy groups processed together by the vectorized attenuation kernel
+#define SIMD_WIDTH 8
+
+#define ATOMIC_TALLY 0
+#define PRIVATE_TALLY 1
+
+#define FLAT_SOURCE 0
+#define LINEAR_SOURCE 1
+
+// Optical thickness below which the linear source exponential terms are
+// evaluated from their Taylor series rather than their closed forms
+#define LINEAR_SOURCE_SERIES_TAU 1.0e-2
+
+// Number of track moments tallied per cell for the linear source: the track
+// length, its first moments about the cell center (x, y), and its second moments
+// (xx, xy, yy)
+#define N_TRACK_MOMENTS 6
+
+// A cell's flux gradient is only estimated when the determinant of its sampled
+// second moment matrix is at least this fraction of the exact value for a fully
+// sampled cell, ( w^2 / 12 )^2. Poorly sampled cells revert to a flat source.
+#define LINEAR_SOURCE_MIN_DETERMINANT 1.0e-2
+
+#define PADDED_SEGMENTS 0
+#define COMPACT_SEGMENTS 1
+
+#define ROW_MAJOR_CELLS 0
+#define MORTON_CELLS 1
+
+#define SEPARATE_CELL_UPDATE 0
+#define FUSED_CELL_UPDATE 1
+
+#define CELL_SOURCE_UPDATE 0
+#define BLOCKED_SOURCE_UPDATE 1
+
+// Number of cells (of one material) whose sources are updated together by the
+// blocked source update, one per SIMD lane
+#define SOURCE_UPDATE_BLOCK_SIZE 8
+
+// Timed phases of each power iteration
+#define PHASE_RAY_SORT 0
+#define PHASE_RAY_TRACE 1
+#define PHASE_FLUX_ATTENUATION 2
+#define PHASE_FUSED_SWEEP 3
+#define PHASE_TALLY_REDUCTION 4
+#define PHASE_UPDATE_ISOTROPIC_SOURCES 5
+#define PHASE_NORMALIZE_SCALAR_FLUX 6
+#define PHASE_ADD_SOURCE_TO_SCALAR_FLUX 7
+#define PHASE_COMPUTE_K_EFF 8
+#define PHASE_FUSED_CELL_UPDATE 9
+#define PHASE_CMFD 10
+#define PHASE_CHECKPOINT 11
+#define PHASE_REDUCTIONS 12
+#define N_PHASES 13
+
+// Hardware performance counters collected for each phase
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_LLC_MISSES 2
+#define PERF_BRANCH_MISSES 3
+#define N_PERF_EVENTS 4
+
+#define PROCEDURAL_GEOMETRY 0
+#define FILE_GEOMETRY 1
+
+#define PROBLEM_FILE_MAGIC "MINRAYPF"
+#define PROBLEM_FILE_VERSION 1
+#define PROBLEM_FILE_ALIGNMENT 64
+
+#define CHECKPOINT_FILE_MAGIC "MINRAYCK"
+#define CHECKPOINT_FILE_VERSION 3
+
+// Width (in cells) of the square tiles that rays are binned into when sorted
+#define RAY_SORT_TILE_WIDTH 8
+
+// CMFD coarse mesh
+#define NO_CMFD 0
+#define PIN_CMFD 1
+
+// CMFD is first applied once the rays' angular fluxes have been through one full iteration
+#define CMFD_FIRST_ITERATION 1
+
+// Shannon entropy mesh (bins per dimension, which must divide the 102 cells per
+// dimension of the smallest mesh) and the number of iterations over which the
+// entropy and k-eff must have stabilized to automatically end the inactive iterations
+#define ENTROPY_MESH_DIMENSION 17
+#define ENTROPY_WINDOW 20
+
+// Minimum number of active iterations before the precision targets are checked,
+// so that the uncertainties are not judged from only a handful of samples
+#define PRECISION_MIN_ACTIVE_ITERATIONS 10
+
+// Mesh sequencing: maximum number of coarse meshes, and the default number of
+// inactive iterations run on each mesh after the solution is prolonged onto it
+// (never more than the -i iterations of the coarsest mesh)
+#define MAX_COARSE_MESH_LEVELS 8
+#define MESH_SEQUENCE_INACTIVE_ITERATIONS 50
+
+// Active iterations between flushes of the float scalar flux accumulators into
+// their double precision totals. A float only sums this many iterations before
+// being flushed, so it keeps nearly full precision however long the run is.
+#define ACCUMULATOR_FLUSH_INTERVAL 64
+
+// Pin powers: the C5G7 core is 51 x 51 pin cells, of which the reference pin
+// powers cover the 34 x 34 pins of the four fuel assemblies
+#define PIN_MESH_DIMENSION 51
+#define REFERENCE_PIN_MESH_DIMENSION 34
+#define REFERENCE_PIN_POWER_FILE "reference_pin_powers.txt"
+
 typedef struct{
   double distance_to_surface;
   double surface_normal_x;
@@ -34,6 +152,32 @@ typedef struct{
   int boundary_condition;
 } CellLookup;
 
+typedef struct{
+  double x;
+  double y;
+  double x_dir;
+  double y_dir;
+  int cell_id;
+  int x_idx;
+  int y_idx;
+  double distance_travelled;
+  int just_hit_vacuum;
+  int is_terminal;
+  // Incremental (DDA) traversal state
+  int step_x;
+  int step_y;
+  double t_max_x;
+  double t_max_y;
+  double t_delta_x;
+  double t_delta_y;
+} RayState;
+
+typedef struct{
+  int cell_id;
+  double distance;
+  int did_vacuum_reflect;
+} Segment;
+
 typedef struct{
   int * material_id;
   float * nu_Sigma_f;
@@ -41,6 +185,18 @@ typedef struct{
   float * Sigma_t;
   float * Sigma_s;
   float * Chi;
+  float * Sigma_t_padded;
+  // Cell ids grouped by material, with each material's cells starting at its offset
+  int * material_cells;
+  int * material_cell_offsets;
+  // The nonzero entries of each row of each material's scattering matrix, as the
+  // first and one past the last outgoing group (i.e., [material][group in][2])
+  int * scatter_group_range;
+  // Whether each material has any fission cross section
+  int * is_fissile;
+  // The binary problem file the cross sections are used in place from, if any
+  void * problem_file_mapping;
+  size_t problem_file_mapping_size;
 } ReadOnlyData;
 
 typedef struct{
@@ -71,8 +227,86 @@ typedef struct{
   int plotting_enabled;
   double cell_volume;
   int validation_problem_id;
+  int sweep_type;
+  int ray_trace_method;
+  int attenuation_type;
+  int source_type;
+  int cell_update_type;
+  int source_update_type;
+  int n_flux_gradient_entries;
+  int n_energy_groups_padded;
+  // Group count of the specialized kernels in use (0 for the generic kernels)
+  int specialized_group_count;
+  int tally_type;
+  int segment_store_type;
+  int ray_sort_interval;
+  int cell_order;
+  // Cell numbering permutation tables (NULL for row-major numbering)
+  int * cell_index;
+  int * cartesian_index;
+  // Problem data locations
+  char * data_directory;
+  char * problem_file;
+  char * output_problem_file;
+  int geometry_source;
+  char * summary_file;
+  int perf_counters_enabled;
+  int cmfd_type;
+  int n_cmfd_cells_per_dimension;
+  int auto_inactive_enabled;
+  double target_k_eff_std_dev;
+  double target_flux_relative_error;
+  int problem_size_multiplier;
+  int n_coarse_mesh_levels;
+  int coarse_mesh_multipliers[MAX_COARSE_MESH_LEVELS];
+  int n_coarse_inactive_iterations;
+  int n_fine_inactive_iterations;
+  char * checkpoint_file;
+  int checkpoint_interval;
+  char * restart_file;
+  int pin_powers_enabled;
 } Parameters;
 
+typedef struct{
+  char magic[8];
+  uint32_t version;
+  uint32_t n_materials;
+  uint32_t n_energy_groups;
+  uint32_t n_cells_per_dimension;
+  double length_per_dimension;
+  uint64_t xs_offset;
+  uint64_t material_map_offset;
+  uint64_t file_size;
+} ProblemFileHeader;
+
+// Power iteration state at the end of an iteration
+typedef struct{
+  int iteration; // Number of iterations completed
+  int is_active_region;
+  int n_inactive_iterations;
+  int source_converged_iteration;
+  double k_eff;
+  double k_eff_total_accumulator;
+  double k_eff_sum_of_squares_accumulator;
+  double entropy;
+  double max_flux_relative_error;
+} CheckpointState;
+
+typedef struct{
+  char magic[8];
+  uint32_t version;
+  uint32_t n_energy_groups;
+  uint32_t n_cells_per_dimension;
+  uint32_t cell_order;
+  uint32_t source_type;
+  uint64_t n_rays;
+  uint64_t seed;
+  double distance_per_ray;
+  uint32_t has_flux_sum_of_squares;
+  uint32_t n_history;
+  CheckpointState state;
+} CheckpointHeader;
+
 typedef struct{
   float * angular_flux;
   double * location_x;
@@ -82,11 +316,29 @@ typedef struct{
   int * cell_id;
 } RayData;
 
+typedef struct{
+  int * cell_ids;
+  float * distances;
+  uint32_t * did_vacuum_reflects;
+  uint64_t n_segments;
+  uint64_t capacity;
+} SegmentBuffer;
+
+typedef struct{
+  int n_threads;
+  uint64_t * offsets;
+  uint64_t * ray_buffer_starts;
+  int * ray_buffer_threads;
+  SegmentBuffer * thread_buffers;
+  SegmentBuffer segments;
+} SegmentStore;
+
 typedef struct{
   int * n_intersections;
   int * cell_ids;
   double * distances;
   int * did_vacuum_reflects;
+  SegmentStore * segmentStore;
 } IntersectionData;
 
 typedef struct{
@@ -94,14 +346,60 @@ typedef struct{
   float * new_scalar_flux;
   float * old_scalar_flux;
   float * scalar_flux_accumulator;
+  float * scalar_flux_sum_of_squares_accumulator;
+  // Double precision totals of the accumulators (see flush_scalar_flux_accumulators)
+  double * scalar_flux_total;
+  double * scalar_flux_sum_of_squares_total;
+  // Linear source only (NULL otherwise): the x and y gradients of the isotropic
+  // source of each cell and group, and the x and y gradients of the scalar flux.
+  // The flux gradient arrays have n_flux_gradient_entries per cell, and are
+  // tallied as the flux spatial moments of each group followed by the track
+  // moments, which compute_flux_gradient_kernel turns into gradients in place.
+  float * source_gradient;
+  float * new_flux_gradient;
+  float * old_flux_gradient;
   int   * hit_count;
   float * fission_rate;
 } CellData;
 
+typedef struct{
+  int n_threads;
+  float * private_scalar_flux;
+  // Linear source flux moment tallies (NULL otherwise)
+  float * private_flux_moments;
+} TallyData;
+
+typedef struct{
+  int is_tallying;
+  int n_cells_per_dimension;
+  int cells_per_coarse_cell;
+  int * coarse_cell_id;
+  // Net currents across the +x and +y surfaces of each coarse cell, and vacuum leakage
+  float * current_x;
+  float * current_y;
+  float * leakage;
+  // Homogenized coarse mesh data
+  double * flux;
+  double * cmfd_flux;
+  double * Sigma_t;
+  double * nu_Sigma_f;
+  double * Chi;
+  double * Sigma_s;
+  double * fission_source;
+  // Surface coupling coefficients
+  double * D_tilde_x;
+  double * D_tilde_y;
+  double * D_hat_x;
+  double * D_hat_y;
+  double * D_hat_boundary;
+} CMFDData;
+
 typedef struct{
   CellData cellData;
   RayData rayData;
   IntersectionData intersectionData;
+  TallyData tallyData;
+  CMFDData cmfdData;
 } ReadWriteData;
 
 typedef struct{
@@ -109,37 +407,79 @@ typedef struct{
   ReadWriteData readWriteData;
 } SimulationData;
 
+typedef struct{
+  int n_threads;
+  int * fds;
+} PerfCounters;
+
+typedef struct{
+  double time[N_PHASES];
+  uint64_t n_calls[N_PHASES];
+  // Hardware counters (NULL if disabled)
+  PerfCounters * perf;
+  uint64_t start_counts[N_PERF_EVENTS];
+  uint64_t counts[N_PHASES][N_PERF_EVENTS];
+} PhaseTimers;
+
 typedef struct{
   uint64_t n_geometric_intersections;
   double runtime_total;
   double runtime_transport_sweep;
+  PhaseTimers timers;
   double k_eff;
   double k_eff_std_dev;
+  double shannon_entropy;
+  int n_inactive_iterations;
+  int n_active_iterations;
+  int n_iterations;
+  double max_flux_relative_error;
+  double runtime_mesh_sequence;
+  int first_iteration;
+  int source_converged_iteration;
+  size_t segment_store_memory_usage;
+  // Pin power errors relative to the reference, in percent
+  double pin_power_rms_error;
+  double pin_power_max_error;
 } SimulationResult;
 
 // io.c
 Parameters read_CLI(int argc, char * argv[]);
+uint64_t get_default_n_rays(int problem_size_multiplier);
+int get_specialized_group_count(int n_energy_groups);
+void set_problem_size(Parameters * P, int problem_size_multiplier);
 ReadOnlyData load_2D_C5G7_XS(Parameters P);
-void plot_3D_vtk(Parameters P, float * scalar_flux_accumulator, int * material_id);
+FILE * open_data_file(Parameters P, const char * name);
+int * load_2D_C5G7_material_ids(Parameters P);
+void plot_3D_vtk(Parameters P, float * scalar_flux_accumulator, int * material_id, int n_active_iterations);
 void print_user_inputs(Parameters P);
 int print_results(Parameters P, SimulationResult SR);
-void print_status_data(int iter, double k_eff, double percent_missed, int is_active_region, double k_eff_total_accumulator, double k_eff_sum_of_squares_accumulator, int n_active_iterations);
+void print_phase_timers(Parameters P, SimulationResult SR);
+void write_summary(Parameters P, SimulationResult SR, int is_valid_result);
+void print_status_data(int iter, double k_eff, double entropy, double percent_missed, int is_active_region, double k_eff_total_accumulator, double k_eff_sum_of_squares_accumulator, int n_active_iterations);
 void center_print(const char *s, int width);
 void border_print(void);
 void print_ray_tracing_buffer(Parameters P, SimulationData SD);
 void print_ray(double x, double y, double x_dir, double y_dir, int cell_id);
 
 // simulation.c
-SimulationResult run_simulation(Parameters P, SimulationData SD);
-void transport_sweep(Parameters P, SimulationData SD);
+SimulationResult run_simulation(Parameters P, SimulationData SD, double k_eff);
+void transport_sweep(Parameters P, SimulationData SD, PhaseTimers * timers);
 void update_isotropic_sources(Parameters P, SimulationData SD, double k_eff);
+void reset_cell_tallies(Parameters P, SimulationData SD, int cell);
 void normalize_scalar_flux(Parameters P, SimulationData SD);
 void add_source_to_scalar_flux(Parameters P, SimulationData SD);
 void compute_cell_fission_rates(Parameters P, SimulationData SD, float * scalar_flux);
 double reduce_sum_float(float * a, int size);
 int reduce_sum_int(int * a, int size);
-double compute_k_eff(Parameters P, SimulationData SD, double old_k_eff);
+double compute_k_eff(Parameters P, SimulationData SD, double old_k_eff, double * total_fission_rate);
 double check_hit_rate(int * hit_count, int n_cells);
+void reduce_scalar_flux_tallies(Parameters P, SimulationData SD);
+void reduce_tally(Parameters P, TallyData TD, float * global_tally, float * private_tally, int n_entries_per_cell);
+double compute_max_flux_relative_error(Parameters P, SimulationData SD, int n_active_iterations);
+void flush_scalar_flux_accumulators(Parameters P, SimulationData SD);
+void flush_cell_scalar_flux_accumulators(Parameters P, SimulationData SD, int cell);
+double fused_cell_update(Parameters P, SimulationData SD, double old_k_eff, double * total_fission_rate, int is_flush_iteration, double * percent_missed);
+void finalize_scalar_flux_accumulators(Parameters P, SimulationData SD);
 
 // rand.c
 double LCG_random_double(uint64_t * seed);
@@ -147,24 +487,136 @@ uint64_t fast_forward_LCG(uint64_t seed, uint64_t n);
 
 // init.c
 SimulationData initialize_simulation(Parameters P);
+void free_simulation(Parameters P, SimulationData SD);
+void initialize_ray_kernel(Parameters P, uint64_t base_seed, int ray_id, double length_per_dimension, double inverse_cell_width, RayData RD);
 void initialize_rays(Parameters P, SimulationData SD);
 void initialize_fluxes(Parameters P, SimulationData SD);
+float * initialize_padded_Sigma_t(Parameters P, float * Sigma_t);
+int * initialize_material_cells(Parameters P, int * material_id, int ** material_cell_offsets);
+int * initialize_scatter_group_range(Parameters P, float * Sigma_s);
+int * initialize_fissile_flags(Parameters P, float * nu_Sigma_f);
 size_t estimate_memory_usage(Parameters P);
+size_t estimate_tally_memory_usage(Parameters P);
 
 // utils.c
 double get_time(void);
+int get_thread_num(void);
+int get_max_threads(void);
 void ptr_swap(float ** a, float ** b);
 void compute_statistics(double sum, double sum_of_squares, int n, double * sample_mean, double * std_dev_of_sample_mean);
 int validate_results(int validation_problem_id, double k_eff);
+uint64_t morton_encode(uint32_t x, uint32_t y);
+
+// checkpoint.c
+CheckpointHeader build_checkpoint_header(Parameters P);
+void write_checkpoint_section(FILE * fp, const void * data, size_t size);
+void read_checkpoint_section(FILE * fp, void * data, size_t size, const char * fname);
+void write_checkpoint(Parameters P, SimulationData SD, CheckpointState state, double * entropy_history, double * k_eff_history);
+CheckpointState read_checkpoint(Parameters P, SimulationData SD, double * entropy_history, double * k_eff_history);
+
+// problem_file.c
+size_t align_problem_file_offset(size_t offset);
+ProblemFileHeader build_problem_file_header(Parameters P);
+void write_problem_section(FILE * fp, const void * data, size_t size, uint64_t offset);
+void write_problem_file(Parameters P, ReadOnlyData ROD, const char * fname);
+int convert_problem_file(Parameters P);
+ReadOnlyData load_problem_file(Parameters P);
+void unmap_problem_file(ReadOnlyData ROD);
+
+// c5g7_geometry.c
+int get_c5g7_pin_material(int pin_x, int pin_y);
+int * generate_2D_C5G7_material_ids(Parameters P);
+
+// cell_order.c
+void number_morton_quadrant(Parameters P, int x0, int y0, int size, int * next_cell_id);
+void initialize_cell_order(Parameters * P);
+void free_cell_order(Parameters P);
+size_t cell_order_memory_usage(Parameters P);
+
+// mesh_sequence.c
+Parameters get_coarse_mesh_parameters(Parameters P, int level);
+void prolong_scalar_flux(Parameters coarse, SimulationData coarse_SD, Parameters fine, SimulationData fine_SD);
+void prolong_rays(Parameters coarse, SimulationData coarse_SD, Parameters fine, SimulationData fine_SD);
+double run_mesh_sequence(Parameters P, SimulationData SD, double * runtime);
+
+// pin_power.c
+double * read_reference_pin_powers(Parameters P);
+void compute_pin_powers(Parameters P, SimulationData SD, double * pin_power);
+void compare_pin_powers(Parameters P, SimulationData SD, double * reference_pin_power, double * rms_error, double * max_error);
+double get_pin_power_figure_of_merit(SimulationResult SR);
+
+// entropy.c
+double compute_shannon_entropy(Parameters P, SimulationData SD);
+int is_window_stationary(double * history, int n);
+int has_source_converged(double * entropy_history, double * k_eff_history, int n);
+
+// cmfd.c
+CMFDData initialize_cmfd_data(Parameters P);
+void free_cmfd_data(CMFDData CMFD);
+size_t cmfd_memory_usage(Parameters P);
+void reset_cmfd_tallies(Parameters P, CMFDData * CMFD);
+void homogenize_cmfd_cross_sections(Parameters P, SimulationData SD, CMFDData * CMFD);
+void compute_surface_coupling(double D_I, double D_N, double phi_I, double phi_N, double current, double inverse_width_squared, double * D_tilde, double * D_hat);
+void compute_cmfd_coupling(Parameters P, CMFDData * CMFD);
+double compute_cmfd_fission_source(Parameters P, CMFDData * CMFD, double volume);
+double get_cmfd_diagonal(CMFDData * CMFD, int coarse_cell, int g, int G, double volume);
+double solve_cmfd_eigenproblem(Parameters P, CMFDData * CMFD, double k_eff);
+void prolong_cmfd_flux(Parameters P, SimulationData SD, CMFDData * CMFD);
+double cmfd_accelerate(Parameters P, SimulationData SD, double k_eff);
+
+// timers.c
+const char * get_phase_name(int phase);
+const char * get_phase_key(int phase);
+double start_phase_timer(PhaseTimers * timers);
+void add_phase_time(PhaseTimers * timers, int phase, double start_time);
+void record_phase_time(PhaseTimers * timers, int phase, double start_time);
+double estimate_phase_bytes(Parameters P, int phase, uint64_t n_calls, uint64_t n_segments);
+
+// perf_counters.c
+const char * get_perf_event_key(int event);
+int open_perf_event(int event, int group_fd);
+PerfCounters * initialize_perf_counters(void);
+void read_perf_counters(PerfCounters * perf, uint64_t * counts);
+
+// ray_sort.c
+uint64_t compute_ray_sort_key(Parameters P, int cell_id);
+void permute_array(void * restrict dst, const void * restrict src, const uint64_t * permutation, uint64_t n, size_t element_size);
+void permute_ray_array(void * array, void * scratch, const uint64_t * permutation, uint64_t n, size_t element_size);
+void sort_rays(Parameters P, SimulationData SD);
+
+// segment_store.c
+void grow_segment_buffer(SegmentBuffer * buffer, uint64_t capacity);
+size_t segment_buffer_memory_usage(SegmentBuffer * buffer);
+SegmentStore * initialize_segment_store(Parameters P);
+void free_segment_buffer(SegmentBuffer * buffer);
+void free_segment_store(SegmentStore * store);
+void reset_segment_buffers(SegmentStore * store);
+void merge_segment_buffers(Parameters P, SimulationData SD);
+uint64_t expected_segments_per_ray(Parameters P);
+size_t segment_store_memory_usage(Parameters P, SimulationData SD);
 
 // ray_trace_kernel.c
 void ray_trace_kernel(Parameters P, SimulationData SD, RayData rayData, uint64_t ray_id);
+void compact_ray_trace_kernel(Parameters P, SimulationData SD, RayData rayData, uint64_t ray_id);
+RayState load_ray_state(Parameters P, RayData rayData, uint64_t ray_id);
+void store_ray_state(RayData rayData, uint64_t ray_id, RayState ray);
+Segment trace_segment(Parameters P, RayState * ray);
+Segment cartesian_trace_segment(Parameters P, RayState * ray);
 CellLookup find_cell_id(Parameters P, double x, double y);
 TraceResult cartesian_ray_trace(double x, double y, double cell_width, int x_idx, int y_idx, double x_dir, double y_dir);
 
+// dda_ray_trace_kernel.c
+void initialize_dda_state(Parameters P, RayState * ray);
+Segment dda_trace_segment(Parameters P, RayState * ray);
+
 // Other kernel files
 void update_isotropic_sources_kernel(Parameters P, SimulationData SD, int cell, int energy_group_in, double inverse_k_eff);
+void update_isotropic_sources_blocked_kernel(Parameters P, SimulationData SD, int material_id, const int * cells, int n_cells, double inverse_k_eff);
 void flux_attenuation_kernel(Parameters P, SimulationData SD, uint64_t ray_id, int energy_group);
+void fused_sweep_kernel(Parameters P, SimulationData SD, uint64_t ray_id);
+void flux_attenuation_vector_kernel(Parameters P, SimulationData SD, uint64_t ray_id);
 void normalize_scalar_flux_kernel(Parameters P, float * new_scalar_flux, int cell, int energy_group);
+void compute_flux_gradient_kernel(Parameters P, SimulationData SD, int cell);
 void add_source_to_scalar_flux_kernel(Parameters P, SimulationData SD, int cell, int energy_group);
+void fused_cell_update_kernel(Parameters P, SimulationData SD, int cell, int is_flush_iteration, float * old_fission_rate, float * new_fission_rate);
 void compute_cell_fission_rates_kernel(Parameters P, SimulationData SD, float * scalar_flux, int cell);
@@ -0,0 +1,113 @@
+#include "minray.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Optional hardware performance counters, collected with the Linux
+// perf_event_open interface so that no external profiler is needed. Each
+// OpenMP thread opens its own group of counters (cycles being the group leader),
+// which only counts user space events of that thread. The counters are read
+// and summed over all threads at the start and end of every timed phase, so
+// the difference gives the events that occurred in the phase. If the counters
+// cannot be opened (e.g., no PMU is exposed in a virtual machine, or
+// /proc/sys/kernel/perf_event_paranoid is too restrictive), a warning is
+// printed and the simulation runs with counters disabled.
+
+static const char * perf_event_names[N_PERF_EVENTS] = {
+  "cycles",
+  "instructions",
+  "llc_misses",
+  "branch_misses"
+};
+
+const char * get_perf_event_key(int event)
+{
+  return perf_event_names[event];
+}
+
+#ifdef __linux__
+static const uint64_t perf_event_configs[N_PERF_EVENTS] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES,
+  PERF_COUNT_HW_BRANCH_MISSES
+};
+
+int open_perf_event(int event, int group_fd)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(struct perf_event_attr));
+  attr.size = sizeof(struct perf_event_attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = perf_event_configs[event];
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  // Counts the calling thread only, on whichever CPU it runs
+  return syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+PerfCounters * initialize_perf_counters(void)
+{
+  #ifdef __linux__
+  PerfCounters * perf = (PerfCounters *) malloc(sizeof(PerfCounters));
+  perf->n_threads = get_max_threads();
+  perf->fds = (int *) malloc(perf->n_threads * N_PERF_EVENTS * sizeof(int));
+  int n_failed = 0;
+
+  #pragma omp parallel num_threads(perf->n_threads)
+  {
+    int * fds = perf->fds + get_thread_num() * N_PERF_EVENTS;
+    for( int event = 0; event < N_PERF_EVENTS; event++ )
+    {
+      fds[event] = open_perf_event(event, (event == 0) ? -1 : fds[0]);
+      if( fds[event] < 0 )
+      {
+        #pragma omp atomic
+        n_failed++;
+      }
+    }
+  }
+
+  if( n_failed == 0 )
+    return perf;
+
+  for( int i = 0; i < perf->n_threads * N_PERF_EVENTS; i++ )
+    if( perf->fds[i] >= 0 )
+      close(perf->fds[i]);
+  free(perf->fds);
+  free(perf);
+  #endif
+
+  printf("WARNING: Hardware performance counters are unavailable on this system. Running without counters.\n");
+  return NULL;
+}
+
+// Sums the current value of each counter over all threads. If the kernel had to
+// multiplex the counters, the values are scaled up to the full time enabled.
+void read_perf_counters(PerfCounters * perf, uint64_t * counts)
+{
+  memset(counts, 0, N_PERF_EVENTS * sizeof(uint64_t));
+
+  #ifdef __linux__
+  for( int thread = 0; thread < perf->n_threads; thread++ )
+  {
+    // Group read format: number of events, time enabled, time running, then one value per event
+    uint64_t buffer[3 + N_PERF_EVENTS];
+    if( read(perf->fds[thread * N_PERF_EVENTS], buffer, sizeof(buffer)) != sizeof(buffer) )
+      continue;
+
+    uint64_t time_enabled = buffer[1];
+    uint64_t time_running = buffer[2];
+    double scale = (time_running > 0 && time_running < time_enabled) ? (double) time_enabled / time_running : 1.0;
+
+    for( int event = 0; event < N_PERF_EVENTS; event++ )
+      counts[event] += buffer[3 + event] * scale;
+  }
+  #endif
+}
@@ -0,0 +1,127 @@
+#include "minray.h"
+#include "cell_order.h"
+
+// Pin powers of the C5G7 core, for comparison against the reference solution
+// in REFERENCE_PIN_POWER_FILE. The fission rate (Sigma_f * phi, summed over
+// energy groups) of each cell's mean scalar flux is summed over the cells of
+// its pin, which at any problem size multiplier is an exact block of cells. Pin
+// powers are normalized to a mean of one over the fuel pins, as is the
+// reference. The reference starts at the core center, i.e., at the pin in the
+// x = 0, y = 50 corner of the mesh here, and runs along increasing x and then
+// decreasing y. Guide tubes and fission chambers are listed as zero, and are
+// left out of the comparison.
+
+// Reads the reference pin powers of the fuel assemblies, and checks that the
+// mesh can be divided into pins. Done at startup, so that a missing reference
+// is found before the simulation is run.
+double * read_reference_pin_powers(Parameters P)
+{
+  if( P.n_cells_per_dimension % PIN_MESH_DIMENSION != 0 )
+  {
+    printf("ERROR: The number of cells per dimension (%d) must be a multiple of %d to compute pin powers\n", P.n_cells_per_dimension, PIN_MESH_DIMENSION);
+    exit(1);
+  }
+
+  char fname[1024];
+  snprintf(fname, sizeof(fname), "%s/%s", P.data_directory, REFERENCE_PIN_POWER_FILE);
+  FILE * fp = fopen(fname, "r");
+  if( fp == NULL )
+  {
+    printf("ERROR: Reference pin power file \"%s\" not found\n", fname);
+    exit(1);
+  }
+
+  int n_pins = REFERENCE_PIN_MESH_DIMENSION * REFERENCE_PIN_MESH_DIMENSION;
+  double * reference_pin_power = (double *) malloc(n_pins * sizeof(double));
+  for( int pin = 0; pin < n_pins; pin++ )
+  {
+    if( fscanf(fp, "%lf", reference_pin_power + pin) != 1 )
+    {
+      printf("ERROR: Reference pin power file \"%s\" is incomplete\n", fname);
+      exit(1);
+    }
+  }
+  fclose(fp);
+
+  return reference_pin_power;
+}
+
+// Computes the (unnormalized) power of all PIN_MESH_DIMENSION^2 pins from the
+// scalar flux accumulators
+void compute_pin_powers(Parameters P, SimulationData SD, double * pin_power)
+{
+  const float * scalar_flux = SD.readWriteData.cellData.scalar_flux_accumulator;
+  int cells_per_pin = P.n_cells_per_dimension / PIN_MESH_DIMENSION;
+
+  #pragma omp parallel for
+  for( int pin = 0; pin < PIN_MESH_DIMENSION * PIN_MESH_DIMENSION; pin++ )
+  {
+    int x_start = (pin % PIN_MESH_DIMENSION) * cells_per_pin;
+    int y_start = (pin / PIN_MESH_DIMENSION) * cells_per_pin;
+    double sum = 0.0;
+    for( int y = y_start; y < y_start + cells_per_pin; y++ )
+    {
+      for( int x = x_start; x < x_start + cells_per_pin; x++ )
+      {
+        uint64_t cell = get_cell_id(P, x, y);
+        const float * Sigma_f = SD.readOnlyData.Sigma_f + SD.readOnlyData.material_id[cell] * P.n_energy_groups;
+        for( int energy_group = 0; energy_group < P.n_energy_groups; energy_group++ )
+          sum += Sigma_f[energy_group] * scalar_flux[cell * P.n_energy_groups + energy_group];
+      }
+    }
+    pin_power[pin] = sum;
+  }
+}
+
+// Computes the RMS and maximum relative errors (in percent) of the pin powers
+// against the reference
+void compare_pin_powers(Parameters P, SimulationData SD, double * reference_pin_power, double * rms_error, double * max_error)
+{
+  double pin_power[PIN_MESH_DIMENSION * PIN_MESH_DIMENSION];
+  compute_pin_powers(P, SD, pin_power);
+
+  // Normalize both to a mean of one over the fuel pins
+  int n_fuel_pins = 0;
+  double total_power = 0.0;
+  double total_reference_power = 0.0;
+  for( int row = 0; row < REFERENCE_PIN_MESH_DIMENSION; row++ )
+  {
+    for( int column = 0; column < REFERENCE_PIN_MESH_DIMENSION; column++ )
+    {
+      double reference = reference_pin_power[row * REFERENCE_PIN_MESH_DIMENSION + column];
+      if( reference <= 0.0 )
+        continue;
+      n_fuel_pins++;
+      total_power += pin_power[(PIN_MESH_DIMENSION - 1 - row) * PIN_MESH_DIMENSION + column];
+      total_reference_power += reference;
+    }
+  }
+
+  double sum_of_squares = 0.0;
+  *max_error = 0.0;
+  for( int row = 0; row < REFERENCE_PIN_MESH_DIMENSION; row++ )
+  {
+    for( int column = 0; column < REFERENCE_PIN_MESH_DIMENSION; column++ )
+    {
+      double reference = reference_pin_power[row * REFERENCE_PIN_MESH_DIMENSION + column];
+      if( reference <= 0.0 )
+        continue;
+      double power = pin_power[(PIN_MESH_DIMENSION - 1 - row) * PIN_MESH_DIMENSION + column];
+      double error = 100.0 * (power / total_power - reference / total_reference_power) / (reference / total_reference_power);
+      sum_of_squares += error * error;
+      if( fabs(error) > *max_error )
+        *max_error = fabs(error);
+    }
+  }
+
+  *rms_error = sqrt(sum_of_squares / n_fuel_pins);
+}
+
+// Accuracy per unit of runtime, 1 / ( RMS error^2 * runtime ), analogous to the
+// Monte Carlo figure of merit. Including the coarse mesh sequence, as it stands
+// in for inactive iterations.
+double get_pin_power_figure_of_merit(SimulationResult SR)
+{
+  double runtime = SR.runtime_total + SR.runtime_mesh_sequence;
+  return 1.0 / (SR.pin_power_rms_error * SR.pin_power_rms_error * runtime);
+}
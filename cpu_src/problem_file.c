@@ -0,0 +1,205 @@
+#include "minray.h"
+#include "cell_order.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Binary problem files hold everything that is otherwise parsed from the ~40
+// text files of the C5G7 data directory: a header, the cross section tables,
+// and a one byte per cell material map (stored in row-major order). Each
+// section starts on a PROBLEM_FILE_ALIGNMENT byte boundary, so the file can be
+// memory mapped and the cross section tables used in place without any parsing.
+//
+// File layout:
+//   ProblemFileHeader
+//   Sigma_t    [n_materials][n_energy_groups]                   (float)
+//   nu_Sigma_f [n_materials][n_energy_groups]                   (float)
+//   Sigma_f    [n_materials][n_energy_groups]                   (float)
+//   Chi        [n_materials][n_energy_groups]                   (float)
+//   Sigma_s    [n_materials][n_energy_groups][n_energy_groups]  (float)
+//   material map [n_cells_per_dimension][n_cells_per_dimension] (uint8_t)
+
+size_t align_problem_file_offset(size_t offset)
+{
+  return ((offset + PROBLEM_FILE_ALIGNMENT - 1) / PROBLEM_FILE_ALIGNMENT) * PROBLEM_FILE_ALIGNMENT;
+}
+
+// Computes the location of each section in a problem file
+ProblemFileHeader build_problem_file_header(Parameters P)
+{
+  ProblemFileHeader header;
+  memset(&header, 0, sizeof(ProblemFileHeader));
+  memcpy(header.magic, PROBLEM_FILE_MAGIC, sizeof(header.magic));
+  header.version = PROBLEM_FILE_VERSION;
+  header.n_materials = P.n_materials;
+  header.n_energy_groups = P.n_energy_groups;
+  header.n_cells_per_dimension = P.n_cells_per_dimension;
+  header.length_per_dimension = P.length_per_dimension;
+
+  size_t xs_size = (4 + P.n_energy_groups) * P.n_materials * P.n_energy_groups * sizeof(float);
+  header.xs_offset = align_problem_file_offset(sizeof(ProblemFileHeader));
+  header.material_map_offset = align_problem_file_offset(header.xs_offset + xs_size);
+  header.file_size = header.material_map_offset + P.n_cells;
+  return header;
+}
+
+void write_problem_section(FILE * fp, const void * data, size_t size, uint64_t offset)
+{
+  fseek(fp, offset, SEEK_SET);
+  if( fwrite(data, 1, size, fp) != size )
+  {
+    printf("ERROR: Unable to write problem file\n");
+    exit(1);
+  }
+}
+
+void write_problem_file(Parameters P, ReadOnlyData ROD, const char * fname)
+{
+  FILE * fp = fopen(fname, "wb");
+  if( fp == NULL )
+  {
+    printf("ERROR: Unable to open problem file \"%s\" for writing\n", fname);
+    exit(1);
+  }
+
+  if( P.n_materials > 256 )
+  {
+    printf("ERROR: Problem files support at most 256 materials\n");
+    exit(1);
+  }
+
+  ProblemFileHeader header = build_problem_file_header(P);
+  size_t sz = P.n_materials * P.n_energy_groups * sizeof(float);
+
+  write_problem_section(fp, &header, sizeof(ProblemFileHeader), 0);
+  write_problem_section(fp, ROD.Sigma_t,    sz, header.xs_offset + 0 * sz);
+  write_problem_section(fp, ROD.nu_Sigma_f, sz, header.xs_offset + 1 * sz);
+  write_problem_section(fp, ROD.Sigma_f,    sz, header.xs_offset + 2 * sz);
+  write_problem_section(fp, ROD.Chi,        sz, header.xs_offset + 3 * sz);
+  write_problem_section(fp, ROD.Sigma_s,    sz * P.n_energy_groups, header.xs_offset + 4 * sz);
+
+  // Material map is stored in row-major order, independent of the cell numbering
+  uint8_t * material_map = (uint8_t *) malloc(P.n_cells * sizeof(uint8_t));
+  for( int y = 0; y < P.n_cells_per_dimension; y++ )
+    for( int x = 0; x < P.n_cells_per_dimension; x++ )
+      material_map[y * P.n_cells_per_dimension + x] = ROD.material_id[get_cell_id(P, x, y)];
+  write_problem_section(fp, material_map, P.n_cells * sizeof(uint8_t), header.material_map_offset);
+
+  free(material_map);
+  fclose(fp);
+}
+
+// Loads the problem data from the text data directory and writes it out as a binary problem file
+int convert_problem_file(Parameters P)
+{
+  center_print("PROBLEM FILE CONVERSION", 79);
+  border_print();
+  ReadOnlyData ROD = load_2D_C5G7_XS(P);
+  printf("Writing binary problem file \"%s\"...\n", P.output_problem_file);
+  write_problem_file(P, ROD, P.output_problem_file);
+  printf("Finished writing problem file!\n");
+  border_print();
+  return 0;
+}
+
+ReadOnlyData load_problem_file(Parameters P)
+{
+  printf("Mapping binary problem file \"%s\"...\n", P.problem_file);
+  int fd = open(P.problem_file, O_RDONLY);
+  if( fd < 0 )
+  {
+    printf("ERROR: Problem file \"%s\" not found\n", P.problem_file);
+    exit(1);
+  }
+
+  struct stat file_stat;
+  fstat(fd, &file_stat);
+  if( file_stat.st_size < sizeof(ProblemFileHeader) )
+  {
+    printf("ERROR: Problem file \"%s\" is truncated\n", P.problem_file);
+    exit(1);
+  }
+
+  // Nothing writes to the cross sections, so the mapping is read only
+  char * data = (char *) mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if( data == MAP_FAILED )
+  {
+    printf("ERROR: Unable to map problem file \"%s\"\n", P.problem_file);
+    exit(1);
+  }
+
+  ProblemFileHeader header;
+  memcpy(&header, data, sizeof(ProblemFileHeader));
+  if( memcmp(header.magic, PROBLEM_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != PROBLEM_FILE_VERSION )
+  {
+    printf("ERROR: \"%s\" is not a version %d minray problem file\n", P.problem_file, PROBLEM_FILE_VERSION);
+    exit(1);
+  }
+  if( header.n_materials != P.n_materials || header.n_energy_groups != P.n_energy_groups || header.length_per_dimension != P.length_per_dimension )
+  {
+    printf("ERROR: Problem file \"%s\" holds %u materials and %u energy groups, which does not match the simulation\n", P.problem_file, header.n_materials, header.n_energy_groups);
+    exit(1);
+  }
+  if( header.n_cells_per_dimension != P.n_cells_per_dimension )
+  {
+    printf("ERROR: Problem file \"%s\" has %u cells per dimension, but the simulation requires %d (use -m %u)\n", P.problem_file, header.n_cells_per_dimension, P.n_cells_per_dimension, header.n_cells_per_dimension / 102);
+    exit(1);
+  }
+  // The section offsets are only trusted if the whole header is as this build would write it
+  ProblemFileHeader expected_header = build_problem_file_header(P);
+  if( memcmp(&header, &expected_header, sizeof(ProblemFileHeader)) != 0 )
+  {
+    printf("ERROR: Problem file \"%s\" has an unexpected section layout\n", P.problem_file);
+    exit(1);
+  }
+  if( file_stat.st_size < header.file_size )
+  {
+    printf("ERROR: Problem file \"%s\" is truncated\n", P.problem_file);
+    exit(1);
+  }
+
+  // Cross sections are used in place
+  size_t sz = P.n_materials * P.n_energy_groups;
+  float * xs = (float *) (data + header.xs_offset);
+
+  ReadOnlyData ROD;
+  ROD.problem_file_mapping = data;
+  ROD.problem_file_mapping_size = file_stat.st_size;
+  ROD.Sigma_t    = xs + 0 * sz;
+  ROD.nu_Sigma_f = xs + 1 * sz;
+  ROD.Sigma_f    = xs + 2 * sz;
+  ROD.Chi        = xs + 3 * sz;
+  ROD.Sigma_s    = xs + 4 * sz;
+
+  // Material map is expanded into the cell numbering in use
+  const uint8_t * material_map = (const uint8_t *) (data + header.material_map_offset);
+  ROD.material_id = (int *) malloc(P.n_cells * sizeof(int));
+
+  int n_invalid_cells = 0;
+  #pragma omp parallel for reduction(+:n_invalid_cells)
+  for( int y = 0; y < P.n_cells_per_dimension; y++ )
+    for( int x = 0; x < P.n_cells_per_dimension; x++ )
+    {
+      int material = material_map[y * P.n_cells_per_dimension + x];
+      if( material >= P.n_materials )
+        n_invalid_cells++;
+      ROD.material_id[get_cell_id(P, x, y)] = material;
+    }
+
+  if( n_invalid_cells > 0 )
+  {
+    printf("ERROR: Problem file \"%s\" assigns %d cells a material outside of the %d materials\n", P.problem_file, n_invalid_cells, P.n_materials);
+    exit(1);
+  }
+
+  printf("Problem file mapped.\n");
+  return ROD;
+}
+
+// Unmaps a problem file loaded by load_problem_file
+void unmap_problem_file(ReadOnlyData ROD)
+{
+  munmap(ROD.problem_file_mapping, ROD.problem_file_mapping_size);
+}
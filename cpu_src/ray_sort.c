@@ -0,0 +1,77 @@
+#include "minray.h"
+#include "cell_order.h"
+
+// Rays are initially sampled uniformly throughout the domain, so neighboring
+// threads (and consecutive rays processed by the same thread) touch unrelated
+// parts of the cell arrays. Periodically sorting the rays by a Morton key of the
+// tile of cells they currently reside in groups spatially nearby rays together,
+// improving the cache reuse of the scalar flux and source arrays.
+
+// Returns the sort key of the tile of cells that a ray currently resides in
+uint64_t compute_ray_sort_key(Parameters P, int cell_id)
+{
+  int x_idx = get_cell_x_idx(P, cell_id);
+  int y_idx = get_cell_y_idx(P, cell_id);
+  return morton_encode(x_idx / RAY_SORT_TILE_WIDTH, y_idx / RAY_SORT_TILE_WIDTH);
+}
+
+// Permutes an array of n elements of the given size such that dst[i] = src[permutation[i]]
+void permute_array(void * restrict dst, const void * restrict src, const uint64_t * permutation, uint64_t n, size_t element_size)
+{
+  #pragma omp parallel for
+  for( uint64_t i = 0; i < n; i++ )
+    memcpy((char *) dst + i * element_size, (const char *) src + permutation[i] * element_size, element_size);
+}
+
+// Permutes an array in place, using the scratch buffer as temporary storage. The
+// array pointer is left unchanged, as copies of the RayData struct are held elsewhere.
+void permute_ray_array(void * array, void * scratch, const uint64_t * permutation, uint64_t n, size_t element_size)
+{
+  permute_array(scratch, array, permutation, n, element_size);
+  memcpy(array, scratch, n * element_size);
+}
+
+// Sorts all rays by their sort keys using a counting sort, and permutes the ray data to match
+void sort_rays(Parameters P, SimulationData SD)
+{
+  RayData * RD = &SD.readWriteData.rayData;
+
+  // Compute sort keys, and the number of rays with each key
+  int n_tiles_per_dimension = (P.n_cells_per_dimension + RAY_SORT_TILE_WIDTH - 1) / RAY_SORT_TILE_WIDTH;
+  uint64_t n_keys = morton_encode(n_tiles_per_dimension - 1, n_tiles_per_dimension - 1) + 1;
+  uint64_t * keys = (uint64_t *) malloc(P.n_rays * sizeof(uint64_t));
+  uint64_t * key_offsets = (uint64_t *) calloc(n_keys + 1, sizeof(uint64_t));
+
+  #pragma omp parallel for
+  for( uint64_t ray = 0; ray < P.n_rays; ray++ )
+    keys[ray] = compute_ray_sort_key(P, RD->cell_id[ray]);
+
+  for( uint64_t ray = 0; ray < P.n_rays; ray++ )
+    key_offsets[keys[ray] + 1]++;
+
+  // Prefix sum to find where the rays of each key start in the sorted order
+  for( uint64_t key = 0; key < n_keys; key++ )
+    key_offsets[key + 1] += key_offsets[key];
+
+  // Determine the permutation (stable, so that ties retain their existing order)
+  uint64_t * permutation = (uint64_t *) malloc(P.n_rays * sizeof(uint64_t));
+  for( uint64_t ray = 0; ray < P.n_rays; ray++ )
+    permutation[key_offsets[keys[ray]]++] = ray;
+
+  // Permute ray data
+  size_t max_element_size = P.n_energy_groups * sizeof(float);
+  if( max_element_size < sizeof(double) )
+    max_element_size = sizeof(double);
+  void * scratch = malloc(P.n_rays * max_element_size);
+  permute_ray_array(RD->angular_flux, scratch, permutation, P.n_rays, P.n_energy_groups * sizeof(float));
+  permute_ray_array(RD->location_x,   scratch, permutation, P.n_rays, sizeof(double));
+  permute_ray_array(RD->location_y,   scratch, permutation, P.n_rays, sizeof(double));
+  permute_ray_array(RD->direction_x,  scratch, permutation, P.n_rays, sizeof(double));
+  permute_ray_array(RD->direction_y,  scratch, permutation, P.n_rays, sizeof(double));
+  permute_ray_array(RD->cell_id,      scratch, permutation, P.n_rays, sizeof(int));
+
+  free(scratch);
+  free(keys);
+  free(key_offsets);
+  free(permutation);
+}
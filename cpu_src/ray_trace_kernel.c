@@ -1,111 +1,183 @@
 #include "minray.h"
+#include "segment_store.h"
+#include "cell_order.h"
 
 void ray_trace_kernel(Parameters P, SimulationData SD, RayData rayData, uint64_t ray_id)
 {
-  double distance_travelled = 0.0;
+  RayState ray = load_ray_state(P, rayData, ray_id);
   int intersection_id = 0;
 
-  double x =     rayData.location_x[ ray_id];
-  double y =     rayData.location_y[ ray_id];
-  double x_dir = rayData.direction_x[ray_id];
-  double y_dir = rayData.direction_y[ray_id];
-  int cell_id =  rayData.cell_id[    ray_id];
-  int x_idx = cell_id % P.n_cells_per_dimension;
-  int y_idx = cell_id / P.n_cells_per_dimension;
-
-  int just_hit_vacuum = 0;
-  int is_terminal = 0;
-
   // We run this loop until either:
   // 1) The maximum number of intersections has been reached (not typical -- would indicate an error)
   // 2) The ray has reached its set distance (typical operation)
-  for( intersection_id = 0; (intersection_id < P.max_intersections_per_ray) && (distance_travelled < P.distance_per_ray); intersection_id++ )
+  for( intersection_id = 0; (intersection_id < P.max_intersections_per_ray) && (ray.distance_travelled < P.distance_per_ray); intersection_id++ )
   {
-    // Perform ray trace through a Cartesian geometry
-    TraceResult trace = cartesian_ray_trace(x, y, P.cell_width, x_idx, y_idx, x_dir, y_dir);
-  
-    // Check to see if ray has reached its maximum distance. Truncate if needed
-    if(distance_travelled + trace.distance_to_surface >= P.distance_per_ray)
-    {
-      trace.distance_to_surface = (P.distance_per_ray - distance_travelled) + BUMP;
-      is_terminal = 1;
-    }
-  
+    // Move the ray across its current cell
+    Segment segment = trace_segment(P, &ray);
+
     // Record intersection information for use by flux attenuation kernel
     uint64_t global_intersection_id = ray_id * P.max_intersections_per_ray + intersection_id;
-    SD.readWriteData.intersectionData.distances[          global_intersection_id] = trace.distance_to_surface;
-    SD.readWriteData.intersectionData.cell_ids[           global_intersection_id] = cell_id;
-    SD.readWriteData.intersectionData.did_vacuum_reflects[global_intersection_id] = just_hit_vacuum;
-    SD.readWriteData.cellData.hit_count[                                 cell_id] = 1;
-    just_hit_vacuum = 0;
-
-    // Move ray forward to intersection surface
-    x += x_dir * trace.distance_to_surface;
-    y += y_dir * trace.distance_to_surface;
-    
-    // Create a test point inside the next cell
-    double x_across_surface = x + trace.surface_normal_x * BUMP;
-    double y_across_surface = y + trace.surface_normal_y * BUMP;
-    
-    // Look up the "neighbor" cell id of the test point.
-    // This function also gives us some info on if we hit a boundary, and what type it was.
-    CellLookup lookup = find_cell_id(P, x_across_surface, y_across_surface);
-    
-    // A sanity check
-    assert(lookup.cell_id != cell_id || is_terminal);
-
-    // If we hit an outer boundary, reflect the ray
-    if( lookup.boundary_condition != NONE && !is_terminal )
-    {
-      trace.surface_normal_x *= -1.0;
-      trace.surface_normal_y *= -1.0;
-      if( trace.surface_normal_x )
-        x_dir *= -1.0;
-      else
-        y_dir *= -1.0;
-    }
-
-    // Note if we hit a vacuum boundary
-    if( lookup.boundary_condition == VACUUM )
-      just_hit_vacuum = 1;
-
-    // If we didn't hit a boundary, the ray is moved into the next cell
-    if( lookup.boundary_condition == NONE )
-    {
-      cell_id = lookup.cell_id;
-      x_idx =   lookup.cartesian_cell_idx_x;
-      y_idx =   lookup.cartesian_cell_idx_y;
-    }
-
-    // Move ray off of surface
-    x += trace.surface_normal_x * BUMP;
-    y += trace.surface_normal_y * BUMP;
-
-    // Add this intersection's distance to the total for the ray
-    distance_travelled += trace.distance_to_surface;
-
-    // Some sanity checks (can be disabled if desired)
-    assert(cell_id >= 0 && cell_id < P.n_cells);
-    assert(x > 0.0 && y > 0.0 && x < P.length_per_dimension && y < P.length_per_dimension);
+    SD.readWriteData.intersectionData.distances[          global_intersection_id] = segment.distance;
+    SD.readWriteData.intersectionData.cell_ids[           global_intersection_id] = segment.cell_id;
+    SD.readWriteData.intersectionData.did_vacuum_reflects[global_intersection_id] = segment.did_vacuum_reflect;
+    SD.readWriteData.cellData.hit_count[                         segment.cell_id] = 1;
   }
 
   if(intersection_id >= P.max_intersections_per_ray)
   {
     printf("WARNING: Increase max number of intersections per ray\n");
-    print_ray(x, y, x_dir, y_dir, cell_id);
+    print_ray(ray.x, ray.y, ray.x_dir, ray.y_dir, ray.cell_id);
   }
   
   // Bank the ray's status for use in the next iteration
-  rayData.location_x[ ray_id] = x;
-  rayData.location_y[ ray_id] = y;
-  rayData.direction_x[ray_id] = x_dir;
-  rayData.direction_y[ray_id] = y_dir;
-  rayData.cell_id[    ray_id] = cell_id;
+  store_ray_state(rayData, ray_id, ray);
     
   // Bank number of intersections that this ray had this iteration
   SD.readWriteData.intersectionData.n_intersections[ray_id] = intersection_id;
 }
 
+// Traces a ray, appending its segments to the calling thread's segment buffer.
+// The buffers are merged into a compact CSR layout after all rays are traced.
+void compact_ray_trace_kernel(Parameters P, SimulationData SD, RayData rayData, uint64_t ray_id)
+{
+  SegmentStore * store = SD.readWriteData.intersectionData.segmentStore;
+  int thread_id = get_thread_num();
+  SegmentBuffer * buffer = &store->thread_buffers[thread_id];
+
+  // Record where this ray's segments start in the thread's buffer
+  store->ray_buffer_threads[ray_id] = thread_id;
+  store->ray_buffer_starts[ ray_id] = buffer->n_segments;
+
+  RayState ray = load_ray_state(P, rayData, ray_id);
+  int n_intersections = 0;
+
+  // Trace the ray until it has reached its set distance
+  while( ray.distance_travelled < P.distance_per_ray )
+  {
+    // Move the ray across its current cell
+    Segment segment = trace_segment(P, &ray);
+
+    // Record intersection information for use by flux attenuation kernel
+    append_segment(buffer, segment);
+    SD.readWriteData.cellData.hit_count[segment.cell_id] = 1;
+    n_intersections++;
+  }
+
+  // Bank the ray's status for use in the next iteration
+  store_ray_state(rayData, ray_id, ray);
+
+  // Bank number of intersections that this ray had this iteration
+  SD.readWriteData.intersectionData.n_intersections[ray_id] = n_intersections;
+}
+
+RayState load_ray_state(Parameters P, RayData rayData, uint64_t ray_id)
+{
+  RayState ray;
+  ray.x =       rayData.location_x[ ray_id];
+  ray.y =       rayData.location_y[ ray_id];
+  ray.x_dir =   rayData.direction_x[ray_id];
+  ray.y_dir =   rayData.direction_y[ray_id];
+  ray.cell_id = rayData.cell_id[    ray_id];
+  ray.x_idx = get_cell_x_idx(P, ray.cell_id);
+  ray.y_idx = get_cell_y_idx(P, ray.cell_id);
+  ray.distance_travelled = 0.0;
+  ray.just_hit_vacuum = 0;
+  ray.is_terminal = 0;
+  if( P.ray_trace_method == DDA_RAY_TRACE )
+    initialize_dda_state(P, &ray);
+  return ray;
+}
+
+void store_ray_state(RayData rayData, uint64_t ray_id, RayState ray)
+{
+  rayData.location_x[ ray_id] = ray.x;
+  rayData.location_y[ ray_id] = ray.y;
+  rayData.direction_x[ray_id] = ray.x_dir;
+  rayData.direction_y[ray_id] = ray.y_dir;
+  rayData.cell_id[    ray_id] = ray.cell_id;
+}
+
+// Moves the ray from its current location to the next cell surface (or to the end of
+// its travel distance), handling boundary conditions. Returns the segment that was
+// traversed so that the caller may either store or attenuate it.
+Segment trace_segment(Parameters P, RayState * ray)
+{
+  if( P.ray_trace_method == DDA_RAY_TRACE )
+    return dda_trace_segment(P, ray);
+  else
+    return cartesian_trace_segment(P, ray);
+}
+
+Segment cartesian_trace_segment(Parameters P, RayState * ray)
+{
+  // Perform ray trace through a Cartesian geometry
+  TraceResult trace = cartesian_ray_trace(ray->x, ray->y, P.cell_width, ray->x_idx, ray->y_idx, ray->x_dir, ray->y_dir);
+
+  // Check to see if ray has reached its maximum distance. Truncate if needed
+  if(ray->distance_travelled + trace.distance_to_surface >= P.distance_per_ray)
+  {
+    trace.distance_to_surface = (P.distance_per_ray - ray->distance_travelled) + BUMP;
+    ray->is_terminal = 1;
+  }
+
+  Segment segment;
+  segment.cell_id = ray->cell_id;
+  segment.distance = trace.distance_to_surface;
+  segment.did_vacuum_reflect = ray->just_hit_vacuum;
+  ray->just_hit_vacuum = 0;
+
+  // Move ray forward to intersection surface
+  ray->x += ray->x_dir * trace.distance_to_surface;
+  ray->y += ray->y_dir * trace.distance_to_surface;
+  
+  // Create a test point inside the next cell
+  double x_across_surface = ray->x + trace.surface_normal_x * BUMP;
+  double y_across_surface = ray->y + trace.surface_normal_y * BUMP;
+  
+  // Look up the "neighbor" cell id of the test point.
+  // This function also gives us some info on if we hit a boundary, and what type it was.
+  CellLookup lookup = find_cell_id(P, x_across_surface, y_across_surface);
+  
+  // A sanity check
+  assert(lookup.cell_id != ray->cell_id || ray->is_terminal);
+
+  // If we hit an outer boundary, reflect the ray
+  if( lookup.boundary_condition != NONE && !ray->is_terminal )
+  {
+    trace.surface_normal_x *= -1.0;
+    trace.surface_normal_y *= -1.0;
+    if( trace.surface_normal_x )
+      ray->x_dir *= -1.0;
+    else
+      ray->y_dir *= -1.0;
+  }
+
+  // Note if we hit a vacuum boundary
+  if( lookup.boundary_condition == VACUUM )
+    ray->just_hit_vacuum = 1;
+
+  // If we didn't hit a boundary, the ray is moved into the next cell
+  if( lookup.boundary_condition == NONE )
+  {
+    ray->cell_id = lookup.cell_id;
+    ray->x_idx =   lookup.cartesian_cell_idx_x;
+    ray->y_idx =   lookup.cartesian_cell_idx_y;
+  }
+
+  // Move ray off of surface
+  ray->x += trace.surface_normal_x * BUMP;
+  ray->y += trace.surface_normal_y * BUMP;
+
+  // Add this intersection's distance to the total for the ray
+  ray->distance_travelled += trace.distance_to_surface;
+
+  // Some sanity checks (can be disabled if desired)
+  assert(ray->cell_id >= 0 && ray->cell_id < P.n_cells);
+  assert(ray->x > 0.0 && ray->y > 0.0 && ray->x < P.length_per_dimension && ray->y < P.length_per_dimension);
+
+  return segment;
+}
+
 CellLookup find_cell_id(Parameters P, double x, double y)
 {
   int cartesian_cell_idx_x = floor(x * P.inverse_cell_width);
@@ -116,7 +188,10 @@ CellLookup find_cell_id(Parameters P, double x, double y)
 
   int boundary_condition = P.boundary_conditions[boundary_x][boundary_y];
 
-  int cell_id = cartesian_cell_idx_y * P.n_cells_per_dimension + cartesian_cell_idx_x; 
+  // Points across an outer boundary have no cell
+  int cell_id = -1;
+  if( boundary_condition == NONE )
+    cell_id = get_cell_id(P, cartesian_cell_idx_x, cartesian_cell_idx_y);
   
   CellLookup lookup;
   lookup.cell_id = cell_id;
@@ -0,0 +1,132 @@
+#include "minray.h"
+#include "segment_store.h"
+
+void grow_segment_buffer(SegmentBuffer * buffer, uint64_t capacity)
+{
+  if( capacity <= buffer->capacity )
+    return;
+
+  uint64_t n_words = (capacity + 31) / 32;
+  buffer->cell_ids            = (int *)      realloc(buffer->cell_ids,            capacity * sizeof(int));
+  buffer->distances           = (float *)    realloc(buffer->distances,           capacity * sizeof(float));
+  buffer->did_vacuum_reflects = (uint32_t *) realloc(buffer->did_vacuum_reflects, n_words  * sizeof(uint32_t));
+  buffer->capacity = capacity;
+
+  if( buffer->cell_ids == NULL || buffer->distances == NULL || buffer->did_vacuum_reflects == NULL )
+  {
+    printf("ERROR: Unable to allocate memory for %lu ray segments\n", capacity);
+    exit(1);
+  }
+}
+
+size_t segment_buffer_memory_usage(SegmentBuffer * buffer)
+{
+  return buffer->capacity * (sizeof(int) + sizeof(float)) + ((buffer->capacity + 31) / 32) * sizeof(uint32_t);
+}
+
+SegmentStore * initialize_segment_store(Parameters P)
+{
+  SegmentStore * store = (SegmentStore *) calloc(1, sizeof(SegmentStore));
+  store->n_threads          = get_max_threads();
+  store->offsets            = (uint64_t *) calloc(P.n_rays + 1, sizeof(uint64_t));
+  store->ray_buffer_starts  = (uint64_t *) calloc(P.n_rays, sizeof(uint64_t));
+  store->ray_buffer_threads = (int *)      calloc(P.n_rays, sizeof(int));
+  store->thread_buffers     = (SegmentBuffer *) calloc(store->n_threads, sizeof(SegmentBuffer));
+
+  // Start each buffer off with room for the expected number of segments
+  uint64_t expected_segments = expected_segments_per_ray(P) * P.n_rays;
+  grow_segment_buffer(&store->segments, expected_segments);
+  for( int thread = 0; thread < store->n_threads; thread++ )
+    grow_segment_buffer(&store->thread_buffers[thread], expected_segments / store->n_threads);
+
+  return store;
+}
+
+void free_segment_buffer(SegmentBuffer * buffer)
+{
+  free(buffer->cell_ids);
+  free(buffer->distances);
+  free(buffer->did_vacuum_reflects);
+}
+
+void free_segment_store(SegmentStore * store)
+{
+  free_segment_buffer(&store->segments);
+  for( int thread = 0; thread < store->n_threads; thread++ )
+    free_segment_buffer(&store->thread_buffers[thread]);
+  free(store->thread_buffers);
+  free(store->offsets);
+  free(store->ray_buffer_starts);
+  free(store->ray_buffer_threads);
+  free(store);
+}
+
+// Each thread's buffer is reset so that its rays can be appended during the ray trace
+void reset_segment_buffers(SegmentStore * store)
+{
+  for( int thread = 0; thread < store->n_threads; thread++ )
+    store->thread_buffers[thread].n_segments = 0;
+}
+
+// Merges all threads' segment buffers into a single CSR array ordered by ray
+void merge_segment_buffers(Parameters P, SimulationData SD)
+{
+  SegmentStore * store = SD.readWriteData.intersectionData.segmentStore;
+  int * n_intersections = SD.readWriteData.intersectionData.n_intersections;
+
+  // Prefix sum over the number of intersections of each ray
+  store->offsets[0] = 0;
+  for( uint64_t ray = 0; ray < P.n_rays; ray++ )
+    store->offsets[ray + 1] = store->offsets[ray] + n_intersections[ray];
+
+  uint64_t n_segments = store->offsets[P.n_rays];
+  if( n_segments > store->segments.capacity )
+    grow_segment_buffer(&store->segments, n_segments + n_segments / 4);
+  store->segments.n_segments = n_segments;
+
+  SegmentBuffer * segments = &store->segments;
+  memset(segments->did_vacuum_reflects, 0, ((n_segments + 31) / 32) * sizeof(uint32_t));
+
+  #pragma omp parallel for schedule(static)
+  for( uint64_t ray = 0; ray < P.n_rays; ray++ )
+  {
+    SegmentBuffer * buffer = &store->thread_buffers[store->ray_buffer_threads[ray]];
+    uint64_t src = store->ray_buffer_starts[ray];
+    uint64_t dst = store->offsets[ray];
+
+    memcpy(segments->cell_ids  + dst, buffer->cell_ids  + src, n_intersections[ray] * sizeof(int));
+    memcpy(segments->distances + dst, buffer->distances + src, n_intersections[ray] * sizeof(float));
+
+    // Vacuum reflections are rare, and rays may share a word of flags with their neighbors
+    for( int i = 0; i < n_intersections[ray]; i++ )
+    {
+      if( get_vacuum_bit(buffer->did_vacuum_reflects, src + i) )
+      {
+        uint64_t idx = dst + i;
+        #pragma omp atomic
+        segments->did_vacuum_reflects[idx / 32] |= 1u << (idx % 32);
+      }
+    }
+  }
+}
+
+// The expected number of cell crossings is the distance travelled divided by the
+// cell width, as the expected value of |x_dir| + |y_dir| for an isotropic
+// direction is unity. One extra is added for the truncated segment at the end.
+uint64_t expected_segments_per_ray(Parameters P)
+{
+  return (uint64_t) (P.distance_per_ray * P.inverse_cell_width) + 1;
+}
+
+size_t segment_store_memory_usage(Parameters P, SimulationData SD)
+{
+  SegmentStore * store = SD.readWriteData.intersectionData.segmentStore;
+  if( store == NULL )
+    return 0;
+
+  size_t sz = (P.n_rays + 1) * sizeof(uint64_t) + P.n_rays * (sizeof(uint64_t) + sizeof(int));
+  sz += segment_buffer_memory_usage(&store->segments);
+  for( int thread = 0; thread < store->n_threads; thread++ )
+    sz += segment_buffer_memory_usage(&store->thread_buffers[thread]);
+  return sz;
+}
@@ -0,0 +1,58 @@
+// Helpers for reading and writing ray segments in the two-phase transport sweep.
+// Segments are either stored in the padded layout (max_intersections_per_ray
+// entries reserved per ray), or in the compact layout, where each thread appends
+// its rays' segments to its own buffer and the buffers are then merged into a
+// single CSR (compressed sparse row) array indexed by a prefix sum over the
+// number of intersections of each ray. The compact layout stores distances in
+// single precision and bit-packs the vacuum reflection flags.
+
+static inline int get_vacuum_bit(const uint32_t * bits, uint64_t idx)
+{
+  return (bits[idx / 32] >> (idx % 32)) & 1u;
+}
+
+// Appends a segment to a thread's buffer, growing the buffer if needed
+static inline void append_segment(SegmentBuffer * buffer, Segment segment)
+{
+  if( buffer->n_segments == buffer->capacity )
+    grow_segment_buffer(buffer, 2 * buffer->capacity + 1024);
+
+  uint64_t idx = buffer->n_segments++;
+  buffer->cell_ids[idx]  = segment.cell_id;
+  buffer->distances[idx] = segment.distance;
+
+  uint32_t mask = 1u << (idx % 32);
+  if( segment.did_vacuum_reflect )
+    buffer->did_vacuum_reflects[idx / 32] |= mask;
+  else
+    buffer->did_vacuum_reflects[idx / 32] &= ~mask;
+}
+
+// Returns the first index of a ray's segments within the segment arrays
+static inline uint64_t get_ray_segment_offset(Parameters P, IntersectionData ID, uint64_t ray_id)
+{
+  if( P.segment_store_type == COMPACT_SEGMENTS )
+    return ID.segmentStore->offsets[ray_id];
+  else
+    return ray_id * P.max_intersections_per_ray;
+}
+
+// Reads a segment given its index within the segment arrays
+static inline Segment load_stored_segment(Parameters P, IntersectionData ID, uint64_t idx)
+{
+  Segment segment;
+  if( P.segment_store_type == COMPACT_SEGMENTS )
+  {
+    SegmentBuffer * segments = &ID.segmentStore->segments;
+    segment.cell_id            = segments->cell_ids[idx];
+    segment.distance           = segments->distances[idx];
+    segment.did_vacuum_reflect = get_vacuum_bit(segments->did_vacuum_reflects, idx);
+  }
+  else
+  {
+    segment.cell_id            = ID.cell_ids[idx];
+    segment.distance           = ID.distances[idx];
+    segment.did_vacuum_reflect = ID.did_vacuum_reflects[idx];
+  }
+  return segment;
+}
@@ -1,77 +1,297 @@
 #include "minray.h"
 
-SimulationResult run_simulation(Parameters P, SimulationData SD)
+SimulationResult run_simulation(Parameters P, SimulationData SD, double k_eff)
 {
-  center_print("SIMULATION", 79);
-  border_print();
-
-  double k_eff = 1.0;
   double k_eff_total_accumulator = 0.0;
   double k_eff_sum_of_squares_accumulator = 0.0;
 
+  // Total fission rate of the old scalar flux, carried over from the previous
+  // iteration's new scalar flux. Zero means it is unknown (at the start of the
+  // run, on restart, or after CMFD has rescaled the flux), and must be recomputed.
+  double total_fission_rate = 0.0;
+
   int is_active_region = 0;
 
+  // With automatic inactive iterations, -i gives the maximum number of inactive
+  // iterations, which is reduced once the fission source has converged. With a
+  // mesh sequence, this only applies on the coarsest mesh.
+  int is_auto_inactive = P.auto_inactive_enabled && P.n_coarse_mesh_levels == 0;
+  int n_inactive_iterations = P.n_inactive_iterations;
+  int source_converged_iteration = -1;
+  double entropy = 0.0;
+  double * entropy_history = NULL;
+  double * k_eff_history = NULL;
+  // With precision targets, -a gives the maximum number of active iterations,
+  // which is reduced once the targets have been reached
+  int n_active_iterations = P.n_active_iterations;
+  int has_precision_target = P.target_k_eff_std_dev > 0.0 || P.target_flux_relative_error > 0.0;
+  double max_flux_relative_error = 0.0;
+
+  if( is_auto_inactive )
+  {
+    entropy_history = (double *) malloc(P.n_inactive_iterations * sizeof(double));
+    k_eff_history   = (double *) malloc(P.n_inactive_iterations * sizeof(double));
+  }
+
+  // The old and new flux arrays are swapped each iteration in this copy of SD only
+  float * caller_old_scalar_flux = SD.readWriteData.cellData.old_scalar_flux;
+  float * caller_old_flux_gradient = SD.readWriteData.cellData.old_flux_gradient;
+
   uint64_t n_total_geometric_intersections = 0;
 
+  PhaseTimers timers;
+  memset(&timers, 0, sizeof(PhaseTimers));
+  if( P.perf_counters_enabled )
+    timers.perf = initialize_perf_counters();
+
+  // Continue from the end of the checkpointed iteration, if restarting
+  int first_iteration = 0;
+  if( P.restart_file != NULL )
+  {
+    CheckpointState state = read_checkpoint(P, SD, entropy_history, k_eff_history);
+    first_iteration = state.iteration;
+    is_active_region = state.is_active_region;
+    // Once the inactive phase has ended, its length is fixed by the original run
+    if( is_active_region || state.source_converged_iteration >= 0 )
+      n_inactive_iterations = state.n_inactive_iterations;
+    source_converged_iteration = state.source_converged_iteration;
+    k_eff = state.k_eff;
+    k_eff_total_accumulator = state.k_eff_total_accumulator;
+    k_eff_sum_of_squares_accumulator = state.k_eff_sum_of_squares_accumulator;
+    entropy = state.entropy;
+    max_flux_relative_error = state.max_flux_relative_error;
+
+    if( first_iteration > n_inactive_iterations + n_active_iterations )
+    {
+      printf("ERROR: The checkpoint is already past the %d active iterations of this simulation\n", n_active_iterations);
+      exit(1);
+    }
+  }
+
   double start_time_simulation = get_time();
-  double time_in_transport_sweep = 0.0;
+  double start_time;
 
   // Power Iteration Loop
-  for( int iter = 0; iter < P.n_iterations; iter++ )
+  for( int iter = first_iteration; iter < n_inactive_iterations + n_active_iterations; iter++ )
   {
     // Reset scalar flux and k-eff accumulators if we have finished our inactive iterations
-    if( iter >= P.n_inactive_iterations && !is_active_region )
+    if( iter >= n_inactive_iterations && !is_active_region )
     {
       is_active_region = 1;
       memset(SD.readWriteData.cellData.scalar_flux_accumulator, 0, P.n_cells * P.n_energy_groups * sizeof(float));
+      memset(SD.readWriteData.cellData.scalar_flux_total, 0, P.n_cells * P.n_energy_groups * sizeof(double));
+      if( SD.readWriteData.cellData.scalar_flux_sum_of_squares_accumulator != NULL )
+      {
+        memset(SD.readWriteData.cellData.scalar_flux_sum_of_squares_accumulator, 0, P.n_cells * P.n_energy_groups * sizeof(float));
+        memset(SD.readWriteData.cellData.scalar_flux_sum_of_squares_total, 0, P.n_cells * P.n_energy_groups * sizeof(double));
+      }
       k_eff_total_accumulator = 0.0;
       k_eff_sum_of_squares_accumulator = 0.0;
     }
 
+    // Periodically reorder rays so that spatially nearby rays are processed together
+    if( P.ray_sort_interval > 0 && iter % P.ray_sort_interval == 0 )
+    {
+      start_time = start_phase_timer(&timers);
+      sort_rays(P, SD);
+      record_phase_time(&timers, PHASE_RAY_SORT, start_time);
+    }
+
     // Recompute the isotropic neutron source based on the last iteration's estimate of the scalar flux
+    // (the fused cell update also resets this iteration's tallies in the same pass)
+    start_time = start_phase_timer(&timers);
     update_isotropic_sources(P, SD, k_eff);
+    record_phase_time(&timers, PHASE_UPDATE_ISOTROPIC_SOURCES, start_time);
 
     // Reset this iteration's scalar flux tallies to zero
-    memset(SD.readWriteData.cellData.new_scalar_flux, 0, P.n_cells * P.n_energy_groups * sizeof(float));
+    if( P.cell_update_type == SEPARATE_CELL_UPDATE )
+    {
+      memset(SD.readWriteData.cellData.new_scalar_flux, 0, P.n_cells * P.n_energy_groups * sizeof(float));
+      if( P.source_type == LINEAR_SOURCE )
+        memset(SD.readWriteData.cellData.new_flux_gradient, 0, P.n_cells * P.n_flux_gradient_entries * sizeof(float));
+    }
+
+    // Tally coarse mesh currents for CMFD acceleration during the inactive iterations
+    SD.readWriteData.cmfdData.is_tallying = P.cmfd_type != NO_CMFD && !is_active_region && iter >= CMFD_FIRST_ITERATION;
+    if( SD.readWriteData.cmfdData.is_tallying )
+      reset_cmfd_tallies(P, &SD.readWriteData.cmfdData);
 
     // Run the transport sweep
-    double start_time_transport = get_time();
-    transport_sweep(P, SD);
-    time_in_transport_sweep += get_time() - start_time_transport;
+    transport_sweep(P, SD, &timers);
+
+    // Sum any thread private scalar flux tallies
+    if( P.tally_type != ATOMIC_TALLY )
+    {
+      start_time = start_phase_timer(&timers);
+      reduce_scalar_flux_tallies(P, SD);
+      record_phase_time(&timers, PHASE_TALLY_REDUCTION, start_time);
+    }
 
-    // Check hit rate to ensure we are running enough rays
-    double percent_missed = check_hit_rate(SD.readWriteData.cellData.hit_count, P.n_cells);
+    int is_flush_iteration = is_active_region && (iter - n_inactive_iterations + 1) % ACCUMULATOR_FLUSH_INTERVAL == 0;
+    double percent_missed;
 
-    // Normalize the scalar flux tallies to the total distance travelled by all rays this iteration
-    normalize_scalar_flux(P, SD);
+    if( P.cell_update_type == FUSED_CELL_UPDATE )
+    {
+      // Check the hit rate, normalize the scalar flux tallies, add the source, and
+      // compute a new estimate of the eigenvalue, all in one pass over the cells
+      start_time = start_phase_timer(&timers);
+      k_eff = fused_cell_update(P, SD, k_eff, &total_fission_rate, is_flush_iteration, &percent_missed);
+      record_phase_time(&timers, PHASE_FUSED_CELL_UPDATE, start_time);
+    }
+    else
+    {
+      // Check hit rate to ensure we are running enough rays
+      start_time = start_phase_timer(&timers);
+      percent_missed = check_hit_rate(SD.readWriteData.cellData.hit_count, P.n_cells);
+      add_phase_time(&timers, PHASE_REDUCTIONS, start_time);
+
+      // Normalize the scalar flux tallies to the total distance travelled by all rays this iteration
+      start_time = start_phase_timer(&timers);
+      normalize_scalar_flux(P, SD);
+      record_phase_time(&timers, PHASE_NORMALIZE_SCALAR_FLUX, start_time);
+
+      // Add the source together with the scalar flux tallies to compute this iteration's estimate of the scalar flux
+      start_time = start_phase_timer(&timers);
+      add_source_to_scalar_flux(P, SD);
+      if( is_flush_iteration )
+        flush_scalar_flux_accumulators(P, SD);
+      record_phase_time(&timers, PHASE_ADD_SOURCE_TO_SCALAR_FLUX, start_time);
+
+      // Compute a new estimate of the eigenvalue based on the old and new scalar fluxes
+      start_time = start_phase_timer(&timers);
+      k_eff = compute_k_eff(P, SD, k_eff, &total_fission_rate);
+      record_phase_time(&timers, PHASE_COMPUTE_K_EFF, start_time);
+    }
 
-    // Add the source together with the scalar flux tallies to compute this iteration's estimate of the scalar flux
-    add_source_to_scalar_flux(P, SD);
+    // Compute the Shannon entropy of the new fission source
+    start_time = start_phase_timer(&timers);
+    entropy = compute_shannon_entropy(P, SD);
+    record_phase_time(&timers, PHASE_REDUCTIONS, start_time);
 
-    // Compute a new estimate of the eigenvalue based on the old and new scalar fluxes
-    k_eff = compute_k_eff(P, SD, k_eff);
+    // Accelerate the convergence of the fission source by solving the coarse mesh diffusion problem
+    if( SD.readWriteData.cmfdData.is_tallying )
+    {
+      start_time = start_phase_timer(&timers);
+      k_eff = cmfd_accelerate(P, SD, k_eff);
+      total_fission_rate = 0.0;
+      record_phase_time(&timers, PHASE_CMFD, start_time);
+    }
     k_eff_total_accumulator += k_eff;
     k_eff_sum_of_squares_accumulator += k_eff * k_eff;
 
     // Set old scalar flux to equal the new scalar flux. To optimize, we simply swap the old and new scalar flux pointers
     ptr_swap(&SD.readWriteData.cellData.new_scalar_flux, &SD.readWriteData.cellData.old_scalar_flux);
+    if( P.source_type == LINEAR_SOURCE )
+      ptr_swap(&SD.readWriteData.cellData.new_flux_gradient, &SD.readWriteData.cellData.old_flux_gradient);
 
     // Compute the total number of intersections performed this iteration
+    start_time = start_phase_timer(&timers);
     n_total_geometric_intersections += reduce_sum_int(SD.readWriteData.intersectionData.n_intersections, P.n_rays);
+    add_phase_time(&timers, PHASE_REDUCTIONS, start_time);
 
     // Output some status data on the results of the power iteration
-    print_status_data(iter, k_eff, percent_missed, is_active_region, k_eff_total_accumulator, k_eff_sum_of_squares_accumulator, iter - P.n_inactive_iterations + 1);
+    print_status_data(iter, k_eff, entropy, percent_missed, is_active_region, k_eff_total_accumulator, k_eff_sum_of_squares_accumulator, iter - n_inactive_iterations + 1);
+
+    // End the inactive iterations early once the entropy and k-eff have stabilized
+    if( is_auto_inactive && !is_active_region )
+    {
+      entropy_history[iter] = entropy;
+      k_eff_history[iter] = k_eff;
+      if( has_source_converged(entropy_history, k_eff_history, iter + 1) )
+      {
+        n_inactive_iterations = iter + 1;
+        source_converged_iteration = iter;
+        printf("Fission source converged at iteration %d. Starting active iterations.\n", iter);
+      }
+      else if( iter == n_inactive_iterations - 1 )
+        printf("WARNING: Fission source did not converge within %d inactive iterations. Starting active iterations.\n", n_inactive_iterations);
+    }
+
+    // End the active iterations early once the precision targets have been reached
+    int n_active_done = iter - n_inactive_iterations + 1;
+    if( has_precision_target && is_active_region && n_active_done >= PRECISION_MIN_ACTIVE_ITERATIONS )
+    {
+      double k_eff_avg, k_eff_std_dev;
+      compute_statistics(k_eff_total_accumulator, k_eff_sum_of_squares_accumulator, n_active_done, &k_eff_avg, &k_eff_std_dev);
+      int is_precise = P.target_k_eff_std_dev <= 0.0 || k_eff_std_dev <= P.target_k_eff_std_dev;
+
+      if( P.target_flux_relative_error > 0.0 )
+      {
+        start_time = start_phase_timer(&timers);
+        max_flux_relative_error = compute_max_flux_relative_error(P, SD, n_active_done);
+        add_phase_time(&timers, PHASE_REDUCTIONS, start_time);
+        is_precise = is_precise && max_flux_relative_error <= P.target_flux_relative_error;
+      }
+
+      if( is_precise && n_active_done < n_active_iterations )
+      {
+        n_active_iterations = n_active_done;
+        printf("Precision targets reached after %d active iterations.\n", n_active_done);
+      }
+    }
+
+    // Write a checkpoint periodically, and after the final iteration
+    int is_last_iteration = iter + 1 == n_inactive_iterations + n_active_iterations;
+    if( P.checkpoint_file != NULL && (is_last_iteration || (P.checkpoint_interval > 0 && (iter + 1) % P.checkpoint_interval == 0)) )
+    {
+      CheckpointState state;
+      state.iteration = iter + 1;
+      state.is_active_region = is_active_region;
+      state.n_inactive_iterations = n_inactive_iterations;
+      state.source_converged_iteration = source_converged_iteration;
+      state.k_eff = k_eff;
+      state.k_eff_total_accumulator = k_eff_total_accumulator;
+      state.k_eff_sum_of_squares_accumulator = k_eff_sum_of_squares_accumulator;
+      state.entropy = entropy;
+      state.max_flux_relative_error = max_flux_relative_error;
+
+      start_time = start_phase_timer(&timers);
+      write_checkpoint(P, SD, state, entropy_history, k_eff_history);
+      record_phase_time(&timers, PHASE_CHECKPOINT, start_time);
+    }
 
   } // End Power Iteration Loop
   
   double runtime_total = get_time() - start_time_simulation;
+
+  free(entropy_history);
+  free(k_eff_history);
+
+  // Hand the full flux sums back in the float accumulators, for output
+  finalize_scalar_flux_accumulators(P, SD);
+
+  // Leave the final scalar flux (and flux gradients) in the caller's old arrays, for
+  // the mesh sequence to prolong
+  if( SD.readWriteData.cellData.old_scalar_flux != caller_old_scalar_flux )
+  {
+    memcpy(caller_old_scalar_flux, SD.readWriteData.cellData.old_scalar_flux, P.n_cells * P.n_energy_groups * sizeof(float));
+    if( P.source_type == LINEAR_SOURCE )
+      memcpy(caller_old_flux_gradient, SD.readWriteData.cellData.old_flux_gradient, P.n_cells * P.n_flux_gradient_entries * sizeof(float));
+  }
   
   // Gather simulation results
   SimulationResult SR;
-  compute_statistics(k_eff_total_accumulator, k_eff_sum_of_squares_accumulator, P.n_active_iterations, &SR.k_eff, &SR.k_eff_std_dev);
+  if( n_active_iterations > 0 )
+    compute_statistics(k_eff_total_accumulator, k_eff_sum_of_squares_accumulator, n_active_iterations, &SR.k_eff, &SR.k_eff_std_dev);
+  else
+  {
+    // Only inactive iterations were run (i.e., a coarse mesh of a mesh sequence)
+    SR.k_eff = k_eff;
+    SR.k_eff_std_dev = 0.0;
+  }
+  SR.shannon_entropy = entropy;
+  SR.n_inactive_iterations = n_inactive_iterations;
+  SR.n_active_iterations = n_active_iterations;
+  SR.n_iterations = n_inactive_iterations + n_active_iterations;
+  SR.max_flux_relative_error = max_flux_relative_error;
+  SR.runtime_mesh_sequence = 0.0;
+  SR.first_iteration = first_iteration;
+  SR.source_converged_iteration = source_converged_iteration;
   SR.n_geometric_intersections = n_total_geometric_intersections;
   SR.runtime_total = runtime_total;
-  SR.runtime_transport_sweep = time_in_transport_sweep;
+  SR.runtime_transport_sweep = timers.time[PHASE_RAY_TRACE] + timers.time[PHASE_FLUX_ATTENUATION] + timers.time[PHASE_FUSED_SWEEP] + timers.time[PHASE_TALLY_REDUCTION];
+  SR.timers = timers;
+  SR.segment_store_memory_usage = segment_store_memory_usage(P, SD);
 
   return SR;
 }
@@ -80,29 +300,165 @@ void update_isotropic_sources(Parameters P, SimulationData SD, double k_eff)
 {
   double inv_k_eff = 1.0/k_eff;
 
-  #pragma omp parallel for
-  for( int cell = 0; cell < P.n_cells; cell++ )
-    for( int energy_group = 0; energy_group < P.n_energy_groups; energy_group++ )
-      update_isotropic_sources_kernel(P, SD, cell, energy_group, inv_k_eff);
+  // The fused cell update resets the sweep's tallies while each cell is being written anyway
+  int is_fused = P.cell_update_type == FUSED_CELL_UPDATE;
+
+  if( P.source_update_type == BLOCKED_SOURCE_UPDATE )
+  {
+    ReadOnlyData ROD = SD.readOnlyData;
+
+    // The blocks of each material are shared out between the threads in turn
+    #pragma omp parallel
+    for( int material = 0; material < P.n_materials; material++ )
+    {
+      int first = ROD.material_cell_offsets[material];
+      int n_material_cells = ROD.material_cell_offsets[material + 1] - first;
+      int n_blocks = (n_material_cells + SOURCE_UPDATE_BLOCK_SIZE - 1) / SOURCE_UPDATE_BLOCK_SIZE;
+
+      #pragma omp for schedule(static) nowait
+      for( int block = 0; block < n_blocks; block++ )
+      {
+        const int * cells = ROD.material_cells + first + block * SOURCE_UPDATE_BLOCK_SIZE;
+        int n_cells = n_material_cells - block * SOURCE_UPDATE_BLOCK_SIZE;
+        if( n_cells > SOURCE_UPDATE_BLOCK_SIZE )
+          n_cells = SOURCE_UPDATE_BLOCK_SIZE;
+
+        update_isotropic_sources_blocked_kernel(P, SD, material, cells, n_cells, inv_k_eff);
+        if( is_fused )
+          for( int i = 0; i < n_cells; i++ )
+            reset_cell_tallies(P, SD, cells[i]);
+      }
+    }
+  }
+  else
+  {
+    #pragma omp parallel for
+    for( int cell = 0; cell < P.n_cells; cell++ )
+    {
+      for( int energy_group = 0; energy_group < P.n_energy_groups; energy_group++ )
+        update_isotropic_sources_kernel(P, SD, cell, energy_group, inv_k_eff);
+      if( is_fused )
+        reset_cell_tallies(P, SD, cell);
+    }
+  }
+}
+
+void reset_cell_tallies(Parameters P, SimulationData SD, int cell)
+{
+  CellData CD = SD.readWriteData.cellData;
+  memset(CD.new_scalar_flux + (uint64_t) cell * P.n_energy_groups, 0, P.n_energy_groups * sizeof(float));
+  if( P.source_type == LINEAR_SOURCE )
+    memset(CD.new_flux_gradient + (uint64_t) cell * P.n_flux_gradient_entries, 0, P.n_flux_gradient_entries * sizeof(float));
 }
 
-void transport_sweep(Parameters P, SimulationData SD)
+void transport_sweep(Parameters P, SimulationData SD, PhaseTimers * timers)
 {
+  double start_time = start_phase_timer(timers);
+
+  // Fused Ray Trace and Flux Attenuate Kernel
+  if( P.sweep_type == FUSED_SWEEP )
+  {
+    #pragma omp parallel for
+    for( int ray = 0; ray < P.n_rays; ray++ )
+      fused_sweep_kernel(P, SD, ray);
+    record_phase_time(timers, PHASE_FUSED_SWEEP, start_time);
+    return;
+  }
+
   // Ray Trace Kernel
-  #pragma omp parallel for
-  for( int ray = 0; ray < P.n_rays; ray++ )
-    ray_trace_kernel(P, SD, SD.readWriteData.rayData, ray);
+  if( P.segment_store_type == COMPACT_SEGMENTS )
+  {
+    reset_segment_buffers(SD.readWriteData.intersectionData.segmentStore);
+
+    #pragma omp parallel for
+    for( int ray = 0; ray < P.n_rays; ray++ )
+      compact_ray_trace_kernel(P, SD, SD.readWriteData.rayData, ray);
 
+    merge_segment_buffers(P, SD);
+  }
+  else
+  {
+    #pragma omp parallel for
+    for( int ray = 0; ray < P.n_rays; ray++ )
+      ray_trace_kernel(P, SD, SD.readWriteData.rayData, ray);
+  }
+  record_phase_time(timers, PHASE_RAY_TRACE, start_time);
+
+  start_time = start_phase_timer(timers);
+
+  // Flux Attenuate Kernel (all energy groups at once)
+  if( P.attenuation_type == VECTOR_ATTENUATION )
+  {
+    #pragma omp parallel for
+    for( int ray = 0; ray < P.n_rays; ray++ )
+      flux_attenuation_vector_kernel(P, SD, ray);
+  }
   // Flux Attenuate Kernel
-  #pragma omp parallel for
-  for( int ray = 0; ray < P.n_rays; ray++ )
-    for( int energy_group = 0; energy_group < P.n_energy_groups; energy_group++ )
-      flux_attenuation_kernel(P, SD, ray, energy_group);
+  else
+  {
+    #pragma omp parallel for
+    for( int ray = 0; ray < P.n_rays; ray++ )
+      for( int energy_group = 0; energy_group < P.n_energy_groups; energy_group++ )
+        flux_attenuation_kernel(P, SD, ray, energy_group);
+  }
+  record_phase_time(timers, PHASE_FLUX_ATTENUATION, start_time);
 }
 
 
+// Sums all threads' private scalar flux tallies into new_scalar_flux (and any
+// linear source moment tallies into new_flux_gradient), and resets the private tallies to
+// zero for the next iteration.
+void reduce_scalar_flux_tallies(Parameters P, SimulationData SD)
+{
+  TallyData TD = SD.readWriteData.tallyData;
+  CellData CD = SD.readWriteData.cellData;
+
+  reduce_tally(P, TD, CD.new_scalar_flux, TD.private_scalar_flux, P.n_energy_groups);
+  if( P.source_type == LINEAR_SOURCE )
+    reduce_tally(P, TD, CD.new_flux_gradient, TD.private_flux_moments, P.n_flux_gradient_entries);
+}
+
+// Sums the private copies of one tally into its global array. The cells are
+// divided into blocks that are reduced in parallel across all threads' copies.
+#define TALLY_REDUCTION_BLOCK_SIZE 4096
+void reduce_tally(Parameters P, TallyData TD, float * global_tally, float * private_tally, int n_entries_per_cell)
+{
+  if( P.tally_type == PRIVATE_TALLY )
+  {
+    uint64_t n_elements = P.n_cells * n_entries_per_cell;
+    uint64_t n_blocks = (n_elements + TALLY_REDUCTION_BLOCK_SIZE - 1) / TALLY_REDUCTION_BLOCK_SIZE;
+
+    #pragma omp parallel for
+    for( uint64_t block = 0; block < n_blocks; block++ )
+    {
+      uint64_t start = block * TALLY_REDUCTION_BLOCK_SIZE;
+      uint64_t end = start + TALLY_REDUCTION_BLOCK_SIZE;
+      if( end > n_elements )
+        end = n_elements;
+
+      for( int thread = 0; thread < TD.n_threads; thread++ )
+      {
+        float * thread_tally = private_tally + thread * n_elements;
+        for( uint64_t i = start; i < end; i++ )
+        {
+          global_tally[i] += thread_tally[i];
+          thread_tally[i] = 0.0f;
+        }
+      }
+    }
+  }
+}
+
 void normalize_scalar_flux(Parameters P, SimulationData SD)
 {
+  // The flux gradients are estimated from the raw tallies, so come first
+  if( P.source_type == LINEAR_SOURCE )
+  {
+    #pragma omp parallel for
+    for( int cell = 0; cell < P.n_cells; cell++ )
+      compute_flux_gradient_kernel(P, SD, cell);
+  }
+
   #pragma omp parallel for
   for( int cell = 0; cell < P.n_cells; cell++ )
     for( int energy_group = 0; energy_group < P.n_energy_groups; energy_group++ )
@@ -117,19 +473,27 @@ void add_source_to_scalar_flux(Parameters P, SimulationData SD)
       add_source_to_scalar_flux_kernel(P, SD, cell, energy_group);
 }
 
-double compute_k_eff(Parameters P, SimulationData SD, double old_k_eff)
+// The total fission rate of the old scalar flux is the new total of the previous
+// iteration, so is passed in rather than recomputed (unless it is zero, i.e.,
+// unknown). It is replaced by the new total on return.
+double compute_k_eff(Parameters P, SimulationData SD, double old_k_eff, double * total_fission_rate)
 {
-  // Compute old fission rates
-  compute_cell_fission_rates(P, SD, SD.readWriteData.cellData.old_scalar_flux);
+  double old_total_fission_rate = *total_fission_rate;
+  if( old_total_fission_rate <= 0.0 )
+  {
+    // Compute old fission rates
+    compute_cell_fission_rates(P, SD, SD.readWriteData.cellData.old_scalar_flux);
+
+    // Reduce total old fission rate
+    old_total_fission_rate = reduce_sum_float(SD.readWriteData.cellData.fission_rate, P.n_cells);
+  }
 
-  // Reduce total old fission rate
-  double old_total_fission_rate = reduce_sum_float(SD.readWriteData.cellData.fission_rate, P.n_cells);
-  
   // Compute new fission rates
   compute_cell_fission_rates(P, SD, SD.readWriteData.cellData.new_scalar_flux);
 
   // Reduce total new fission rate
   double new_total_fission_rate = reduce_sum_float(SD.readWriteData.cellData.fission_rate, P.n_cells);
+  *total_fission_rate = new_total_fission_rate;
 
   // Update estimate of k-eff
   double new_k_eff = old_k_eff * (new_total_fission_rate / old_total_fission_rate);
@@ -137,6 +501,51 @@ double compute_k_eff(Parameters P, SimulationData SD, double old_k_eff)
   return new_k_eff;
 }
   
+// Fused cell update. Between the transport sweep and the next source update,
+// the separate path walks the cell arrays once each to check the hit rate,
+// normalize the scalar flux, add the source, and (twice) compute the cell
+// fission rates, with a further pass to sum each of them. Here all of this is
+// done cell by cell in a single parallel loop, so each cell's data is streamed
+// from memory once, and all the sums are folded into the loop as reductions.
+// (The source update itself needs the k-eff that this pass produces, so cannot
+// join it, but it takes over resetting the tallies for the next sweep.)
+// Returns the new estimate of k-eff, and leaves the new fission rates in the
+// fission_rate array, and the total fission rate, as compute_k_eff does (the
+// old scalar flux is only read if its total is unknown).
+double fused_cell_update(Parameters P, SimulationData SD, double old_k_eff, double * total_fission_rate, int is_flush_iteration, double * percent_missed)
+{
+  CellData CD = SD.readWriteData.cellData;
+  int is_old_rate_known = *total_fission_rate > 0.0;
+  double old_total_fission_rate = 0.0;
+  double new_total_fission_rate = 0.0;
+  int n_cells_hit = 0;
+
+  #pragma omp parallel for reduction(+:old_total_fission_rate, new_total_fission_rate, n_cells_hit)
+  for( int cell = 0; cell < P.n_cells; cell++ )
+  {
+    n_cells_hit += CD.hit_count[cell];
+    CD.hit_count[cell] = 0;
+
+    // The flux gradients are estimated from the raw tallies, so come first
+    if( P.source_type == LINEAR_SOURCE )
+      compute_flux_gradient_kernel(P, SD, cell);
+
+    float old_fission_rate = 0.0f;
+    float new_fission_rate;
+    fused_cell_update_kernel(P, SD, cell, is_flush_iteration, is_old_rate_known ? NULL : &old_fission_rate, &new_fission_rate);
+    old_total_fission_rate += old_fission_rate;
+    new_total_fission_rate += new_fission_rate;
+  }
+
+  *percent_missed = (1.0 - (double) n_cells_hit / P.n_cells) * 100.0;
+
+  if( is_old_rate_known )
+    old_total_fission_rate = *total_fission_rate;
+  *total_fission_rate = new_total_fission_rate;
+
+  return old_k_eff * (new_total_fission_rate / old_total_fission_rate);
+}
+
 void compute_cell_fission_rates(Parameters P, SimulationData SD, float * scalar_flux)
 {
   #pragma omp parallel for
@@ -144,7 +553,8 @@ void compute_cell_fission_rates(Parameters P, SimulationData SD, float * scalar_
     compute_cell_fission_rates_kernel(P, SD, scalar_flux, cell);
 }
 
-// May need to be a pairwise reduction
+// Summed in double precision, so the rounding error (of order size * 1e-16) stays
+// well below the float precision of the inputs for any mesh that fits in memory
 double reduce_sum_float(float * a, int size)
 {
   double sum = 0.0;
@@ -168,6 +578,81 @@ int reduce_sum_int(int * a, int size)
 }
 
 
+// Returns the largest relative standard deviation of the mean scalar flux over all
+// cells and energy groups, given the active iteration flux accumulators
+double compute_max_flux_relative_error(Parameters P, SimulationData SD, int n_active_iterations)
+{
+  CellData CD = SD.readWriteData.cellData;
+  uint64_t n_elements = P.n_cells * P.n_energy_groups;
+  double max_relative_error = 0.0;
+
+  #pragma omp parallel for reduction(max:max_relative_error)
+  for( uint64_t i = 0; i < n_elements; i++ )
+  {
+    double mean, std_dev;
+    double sum = CD.scalar_flux_total[i] + CD.scalar_flux_accumulator[i];
+    double sum_of_squares = CD.scalar_flux_sum_of_squares_total[i] + CD.scalar_flux_sum_of_squares_accumulator[i];
+    compute_statistics(sum, sum_of_squares, n_active_iterations, &mean, &std_dev);
+    // Roundoff in the accumulators can make the variance slightly negative
+    double relative_error = (mean > 0.0 && !isnan(std_dev)) ? std_dev / mean : 0.0;
+    if( relative_error > max_relative_error )
+      max_relative_error = relative_error;
+  }
+
+  return max_relative_error;
+}
+
+// The per-iteration flux sums are accumulated in float, which after a few thousand
+// iterations would have lost most of the precision of each new term. Instead, the
+// float accumulators are added into double precision totals and reset every
+// ACCUMULATOR_FLUSH_INTERVAL active iterations. The add-source kernel therefore
+// still only streams the float arrays, and the (twice as large) totals are only
+// touched once per interval.
+void flush_scalar_flux_accumulators(Parameters P, SimulationData SD)
+{
+  #pragma omp parallel for
+  for( int cell = 0; cell < P.n_cells; cell++ )
+    flush_cell_scalar_flux_accumulators(P, SD, cell);
+}
+
+void flush_cell_scalar_flux_accumulators(Parameters P, SimulationData SD, int cell)
+{
+  CellData CD = SD.readWriteData.cellData;
+  uint64_t start = (uint64_t) cell * P.n_energy_groups;
+
+  for( uint64_t i = start; i < start + P.n_energy_groups; i++ )
+  {
+    CD.scalar_flux_total[i] += CD.scalar_flux_accumulator[i];
+    CD.scalar_flux_accumulator[i] = 0.0f;
+    if( CD.scalar_flux_sum_of_squares_accumulator != NULL )
+    {
+      CD.scalar_flux_sum_of_squares_total[i] += CD.scalar_flux_sum_of_squares_accumulator[i];
+      CD.scalar_flux_sum_of_squares_accumulator[i] = 0.0f;
+    }
+  }
+}
+
+// Leaves the full sums (total plus any unflushed iterations) in the float
+// accumulators, which is where the output routines read them from. Rounding the
+// final sum to float loses nothing of consequence, unlike summing in float.
+void finalize_scalar_flux_accumulators(Parameters P, SimulationData SD)
+{
+  CellData CD = SD.readWriteData.cellData;
+  uint64_t n_elements = P.n_cells * P.n_energy_groups;
+
+  #pragma omp parallel for
+  for( uint64_t i = 0; i < n_elements; i++ )
+  {
+    CD.scalar_flux_accumulator[i] += CD.scalar_flux_total[i];
+    CD.scalar_flux_total[i] = 0.0;
+    if( CD.scalar_flux_sum_of_squares_accumulator != NULL )
+    {
+      CD.scalar_flux_sum_of_squares_accumulator[i] += CD.scalar_flux_sum_of_squares_total[i];
+      CD.scalar_flux_sum_of_squares_total[i] = 0.0;
+    }
+  }
+}
+
 double check_hit_rate(int * hit_count, int n_cells)
 {
   // Determine how many FSRs were hit
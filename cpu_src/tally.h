@@ -0,0 +1,46 @@
+// Scalar flux tally helpers shared by the flux attenuation kernels. Depending on
+// the tally strategy, a thread accumulates its segment contributions either
+// atomically into the global new_scalar_flux array, or into its own private copy
+// of the full array. Private copies are allocated up front by
+// initialize_tally_data() and summed into new_scalar_flux by reduce_tally().
+// The linear source flux moments (two entries per energy group) are tallied in
+// the same way, into new_flux_gradient.
+
+// Returns a pointer to the first of a cell's n_entries_per_cell tally entries
+static inline float * get_cell_tally(Parameters P, int thread_id, uint64_t cell_id, int n_entries_per_cell, float * global_tally, float * private_tally)
+{
+  uint64_t tally_idx = cell_id * n_entries_per_cell;
+
+  if( P.tally_type == PRIVATE_TALLY )
+    return private_tally + thread_id * P.n_cells * n_entries_per_cell + tally_idx;
+
+  return global_tally + tally_idx;
+}
+
+// Returns a pointer to the first energy group of the tally entries for a cell
+static inline float * get_scalar_flux_tally(Parameters P, SimulationData SD, int thread_id, uint64_t cell_id)
+{
+  TallyData TD = SD.readWriteData.tallyData;
+  return get_cell_tally(P, thread_id, cell_id, P.n_energy_groups, SD.readWriteData.cellData.new_scalar_flux, TD.private_scalar_flux);
+}
+
+// Returns a pointer to the x moment of the first energy group of the linear source moment tally entries for a cell
+static inline float * get_flux_moments_tally(Parameters P, SimulationData SD, int thread_id, uint64_t cell_id)
+{
+  TallyData TD = SD.readWriteData.tallyData;
+  return get_cell_tally(P, thread_id, cell_id, P.n_flux_gradient_entries, SD.readWriteData.cellData.new_flux_gradient, TD.private_flux_moments);
+}
+
+// Adds a contribution to a tally entry. This is called once per energy group of
+// every segment (and for every flux moment under the linear source), so it is
+// forced inline: out of line, each call copies the Parameters struct
+static inline __attribute__((always_inline)) void tally_scalar_flux(Parameters P, float * tally, float delta_psi)
+{
+  if( P.tally_type == ATOMIC_TALLY )
+  {
+    #pragma omp atomic
+    *tally += delta_psi;
+  }
+  else
+    *tally += delta_psi;
+}
@@ -0,0 +1,181 @@
+#include "minray.h"
+
+// Each phase of the power iteration is timed individually. Alongside the time,
+// the number of bytes each phase moves to or from memory is estimated from the
+// sizes of the arrays it streams through, so that an effective bandwidth can be
+// reported. Small, cache resident arrays (e.g., cross sections) are not counted.
+
+static const char * phase_names[N_PHASES] = {
+  "Ray Sort",
+  "Ray Trace",
+  "Flux Attenuation",
+  "Fused Sweep",
+  "Tally Reduction",
+  "Update Isotropic Sources",
+  "Normalize Scalar Flux",
+  "Add Source to Scalar Flux",
+  "Compute k-eff",
+  "Fused Cell Update",
+  "CMFD",
+  "Checkpoint",
+  "Reductions"
+};
+
+static const char * phase_keys[N_PHASES] = {
+  "ray_sort",
+  "ray_trace",
+  "flux_attenuation",
+  "fused_sweep",
+  "tally_reduction",
+  "update_isotropic_sources",
+  "normalize_scalar_flux",
+  "add_source_to_scalar_flux",
+  "compute_k_eff",
+  "fused_cell_update",
+  "cmfd",
+  "checkpoint",
+  "reductions"
+};
+
+const char * get_phase_name(int phase)
+{
+  return phase_names[phase];
+}
+
+const char * get_phase_key(int phase)
+{
+  return phase_keys[phase];
+}
+
+// Marks the start of a phase, returning the start time
+double start_phase_timer(PhaseTimers * timers)
+{
+  if( timers->perf != NULL )
+    read_perf_counters(timers->perf, timers->start_counts);
+  return get_time();
+}
+
+// Adds the time and hardware counter events since start_phase_timer() to a phase
+void add_phase_time(PhaseTimers * timers, int phase, double start_time)
+{
+  timers->time[phase] += get_time() - start_time;
+
+  if( timers->perf != NULL )
+  {
+    uint64_t counts[N_PERF_EVENTS];
+    read_perf_counters(timers->perf, counts);
+    for( int event = 0; event < N_PERF_EVENTS; event++ )
+      timers->counts[phase][event] += counts[event] - timers->start_counts[event];
+  }
+}
+
+void record_phase_time(PhaseTimers * timers, int phase, double start_time)
+{
+  add_phase_time(timers, phase, start_time);
+  timers->n_calls[phase]++;
+}
+
+// Returns the estimated number of bytes moved by all calls to a phase
+double estimate_phase_bytes(Parameters P, int phase, uint64_t n_calls, uint64_t n_segments)
+{
+  double G = P.n_energy_groups;
+  double n_rays = P.n_rays;
+  double n_cells = P.n_cells;
+
+  // Ray location, direction, and cell id
+  double ray_state_bytes = 4 * sizeof(double) + sizeof(int);
+  double ray_flux_bytes = G * sizeof(float);
+
+  // Bytes to store one segment
+  double segment_bytes;
+  if( P.segment_store_type == COMPACT_SEGMENTS )
+    segment_bytes = sizeof(int) + sizeof(float) + 1.0 / 8.0;
+  else
+    segment_bytes = 2 * sizeof(int) + sizeof(double);
+
+  // The linear source adds the source and flux gradients (two per group), and the
+  // flux and track moment tallies
+  int is_linear_source = P.source_type == LINEAR_SOURCE;
+  int n_moments = is_linear_source ? P.n_flux_gradient_entries : 0;
+
+  double per_call = 0.0;
+  double per_segment = 0.0;
+
+  switch( phase )
+  {
+    case PHASE_RAY_SORT:
+      per_call = n_rays * (2 * (ray_state_bytes + ray_flux_bytes) + 3 * sizeof(uint64_t));
+      break;
+    case PHASE_RAY_TRACE:
+      per_call = n_rays * (2 * ray_state_bytes + sizeof(int));
+      // Compact segments are written to the thread buffers, and then copied into the merged store
+      per_segment = sizeof(int) + ((P.segment_store_type == COMPACT_SEGMENTS) ? 3 : 1) * segment_bytes;
+      break;
+    case PHASE_FLUX_ATTENUATION:
+      per_call = n_rays * (sizeof(int) + 2 * ray_flux_bytes);
+      // Per group: total cross section and source reads, and a read-modify-write of the tally
+      if( P.attenuation_type == VECTOR_ATTENUATION )
+        per_segment = segment_bytes + sizeof(int) + G * 4 * sizeof(float);
+      else
+        per_segment = G * (segment_bytes + sizeof(int) + 4 * sizeof(float));
+      break;
+    case PHASE_FUSED_SWEEP:
+      per_call = n_rays * (2 * ray_state_bytes + 2 * ray_flux_bytes + sizeof(int));
+      per_segment = 2 * sizeof(int) + (G * (is_linear_source ? 6 : 4) + 2 * n_moments) * sizeof(float);
+      break;
+    case PHASE_TALLY_REDUCTION:
+      if( P.tally_type != ATOMIC_TALLY )
+        per_call = n_cells * (G + n_moments) * sizeof(float) * (2 * get_max_threads() + 2);
+      break;
+    case PHASE_UPDATE_ISOTROPIC_SOURCES:
+      per_call = n_cells * (sizeof(int) + (is_linear_source ? 6 : 2) * G * sizeof(float));
+      // The fused cell update also resets the next sweep's tallies here
+      if( P.cell_update_type == FUSED_CELL_UPDATE )
+        per_call += n_cells * (G + n_moments) * sizeof(float);
+      break;
+    case PHASE_NORMALIZE_SCALAR_FLUX:
+      // The flux gradients also read the sources of the sweep
+      per_call = n_cells * ((is_linear_source ? 8 : 2) * G + n_moments) * sizeof(float);
+      break;
+    case PHASE_ADD_SOURCE_TO_SCALAR_FLUX:
+      per_call = n_cells * (2 * sizeof(int) + 5 * G * sizeof(float));
+      // Plus the periodic flush of the accumulators into their double precision totals
+      per_call += n_cells * G * 2 * (sizeof(float) + sizeof(double)) / (double) ACCUMULATOR_FLUSH_INTERVAL;
+      break;
+    case PHASE_COMPUTE_K_EFF:
+      // Fission rates are computed and reduced for the new scalar flux only (the old
+      // total is carried over from the previous iteration)
+      per_call = n_cells * (sizeof(int) + G * sizeof(float) + 2 * sizeof(float));
+      break;
+    case PHASE_FUSED_CELL_UPDATE:
+      // Hit counts and materials, the new scalar flux, source, and accumulators (as
+      // for the separate phases, but streamed once), and the fission rates for k-eff
+      per_call = n_cells * (3 * sizeof(int) + (5 * G + 1) * sizeof(float));
+      if( P.target_flux_relative_error > 0.0 )
+        per_call += n_cells * 2 * G * sizeof(float);
+      if( is_linear_source )
+        per_call += n_cells * (4 * G + n_moments) * sizeof(float);
+      per_call += n_cells * G * 2 * (sizeof(float) + sizeof(double)) / (double) ACCUMULATOR_FLUSH_INTERVAL;
+      break;
+    case PHASE_CMFD:
+      // Homogenization reads the scalar flux, which is then rescaled along with the rays' angular fluxes
+      per_call = n_cells * (2 * sizeof(int) + 3 * G * sizeof(float)) + n_rays * (sizeof(int) + 2 * ray_flux_bytes);
+      break;
+    case PHASE_CHECKPOINT:
+      // Scalar flux and its accumulators (and their totals), and the ray states and angular fluxes
+      per_call = n_cells * G * ((P.target_flux_relative_error > 0.0) ? 3 : 2) * sizeof(float) + n_rays * (ray_state_bytes + ray_flux_bytes);
+      per_call += n_cells * G * ((P.target_flux_relative_error > 0.0) ? 2 : 1) * sizeof(double);
+      if( is_linear_source )
+        per_call += n_cells * n_moments * sizeof(float);
+      break;
+    case PHASE_REDUCTIONS:
+      // Intersection counts, the fission rates binned for the Shannon entropy, and
+      // (unless checked by the fused cell update) the hit counts
+      per_call = n_rays * sizeof(int) + n_cells * (sizeof(int) + sizeof(float));
+      if( P.cell_update_type == SEPARATE_CELL_UPDATE )
+        per_call += n_cells * sizeof(int);
+      break;
+  }
+
+  return per_call * n_calls + per_segment * n_segments;
+}
@@ -0,0 +1,144 @@
+#include "minray.h"
+#include "group_specialization.h"
+
+// Blocked source update. Cells are grouped by material (see
+// initialize_material_cells), so a block of SOURCE_UPDATE_BLOCK_SIZE cells shares
+// one set of cross sections, and its sources are the product of the material's
+// G x G scattering matrix with the block's G x B matrix of scalar fluxes (one
+// cell per SIMD lane), plus the fission term. Each cell's fission production is
+// found once, rather than once per group. The matrix product is specialized on
+// the energy group count (see group_specialization.h), so that for small group
+// counts such as the 7 of C5G7 the group loops are fully unrolled, with the
+// block's fluxes held in registers. As in
+// update_isotropic_sources_kernel, only the nonzero band of each scattering
+// matrix row is summed, and the fission production is skipped for non-fissile
+// materials. The arithmetic of each source is the same in both, so they give
+// identical results.
+
+// Copies G values of each of the block's cells (stride apart in the cell's
+// entries_per_cell entries of array) into the rows of a G x B block, zeroing
+// any unused lanes
+SPECIALIZED_INLINE void gather_block(const int G, const float * array, int entries_per_cell, int stride, const int * cells, int n_cells, float * block)
+{
+  for( int lane = 0; lane < SOURCE_UPDATE_BLOCK_SIZE; lane++ )
+  {
+    if( lane < n_cells )
+    {
+      const float * x = array + (uint64_t) cells[lane] * entries_per_cell;
+      for( int g = 0; g < G; g++ )
+        block[g * SOURCE_UPDATE_BLOCK_SIZE + lane] = x[g * stride];
+    }
+    else
+      for( int g = 0; g < G; g++ )
+        block[g * SOURCE_UPDATE_BLOCK_SIZE + lane] = 0.0f;
+  }
+}
+
+// Multiplies the scattering matrix into a G x B block of fluxes, and finds the
+// fission production of each of its cells (zero if not fissile)
+SPECIALIZED_INLINE void multiply_source_block(const int G, const float * restrict Sigma_s, const int * restrict scatter_range, const float * restrict nu_Sigma_f, int is_fissile, const float * restrict x, float * restrict scatter, float * restrict fission)
+{
+  #pragma omp simd
+  for( int lane = 0; lane < SOURCE_UPDATE_BLOCK_SIZE; lane++ )
+    fission[lane] = 0.0f;
+  for( int energy_group_out = 0; energy_group_out < (is_fissile ? G : 0); energy_group_out++ )
+  {
+    #pragma omp simd
+    for( int lane = 0; lane < SOURCE_UPDATE_BLOCK_SIZE; lane++ )
+      fission[lane] += nu_Sigma_f[energy_group_out] * x[energy_group_out * SOURCE_UPDATE_BLOCK_SIZE + lane];
+  }
+
+  for( int energy_group_in = 0; energy_group_in < G; energy_group_in++ )
+  {
+    const float * row = Sigma_s + energy_group_in * G;
+    const int * range = scatter_range + energy_group_in * 2;
+    float * s = scatter + energy_group_in * SOURCE_UPDATE_BLOCK_SIZE;
+
+    #pragma omp simd
+    for( int lane = 0; lane < SOURCE_UPDATE_BLOCK_SIZE; lane++ )
+      s[lane] = 0.0f;
+    for( int energy_group_out = range[0]; energy_group_out < range[1]; energy_group_out++ )
+    {
+      #pragma omp simd
+      for( int lane = 0; lane < SOURCE_UPDATE_BLOCK_SIZE; lane++ )
+        s[lane] += row[energy_group_out] * x[energy_group_out * SOURCE_UPDATE_BLOCK_SIZE + lane];
+    }
+  }
+}
+
+SPECIALIZED_INLINE void update_isotropic_sources_block(Parameters P, SimulationData SD, const int G, int material_id, const int * cells, int n_cells, double inverse_k_eff)
+{
+  CellData CD = SD.readWriteData.cellData;
+  const int XS_base = material_id * G;
+  const float * Sigma_s    = SD.readOnlyData.Sigma_s + XS_base * G;
+  const float * nu_Sigma_f = SD.readOnlyData.nu_Sigma_f + XS_base;
+  const float * Chi        = SD.readOnlyData.Chi + XS_base;
+  const float * Sigma_t    = SD.readOnlyData.Sigma_t + XS_base;
+  const int * scatter_range = SD.readOnlyData.scatter_group_range + XS_base * 2;
+  int is_fissile = SD.readOnlyData.is_fissile[material_id];
+
+  float flux[G * SOURCE_UPDATE_BLOCK_SIZE];
+  float scatter[G * SOURCE_UPDATE_BLOCK_SIZE];
+  float fission[SOURCE_UPDATE_BLOCK_SIZE];
+
+  gather_block(G, CD.old_scalar_flux, G, 1, cells, n_cells, flux);
+  multiply_source_block(G, Sigma_s, scatter_range, nu_Sigma_f, is_fissile, flux, scatter, fission);
+
+  for( int energy_group_in = 0; energy_group_in < G; energy_group_in++ )
+  {
+    double chi = Chi[energy_group_in] * inverse_k_eff;
+    float sigma_t = Sigma_t[energy_group_in];
+    float * s = scatter + energy_group_in * SOURCE_UPDATE_BLOCK_SIZE;
+
+    #pragma omp simd
+    for( int lane = 0; lane < SOURCE_UPDATE_BLOCK_SIZE; lane++ )
+    {
+      float fission_source = fission[lane] * chi;
+      s[lane] = (s[lane] + fission_source) / sigma_t;
+    }
+  }
+
+  for( int lane = 0; lane < n_cells; lane++ )
+  {
+    float * isotropic_source = CD.isotropic_source + (uint64_t) cells[lane] * G;
+    for( int energy_group = 0; energy_group < G; energy_group++ )
+      isotropic_source[energy_group] = scatter[energy_group * SOURCE_UPDATE_BLOCK_SIZE + lane];
+  }
+
+  if( P.source_type != LINEAR_SOURCE )
+    return;
+
+  // The source gradients are found from the flux gradients in the same way
+  for( int dimension = 0; dimension < 2; dimension++ )
+  {
+    gather_block(G, CD.old_flux_gradient + dimension, P.n_flux_gradient_entries, 2, cells, n_cells, flux);
+    multiply_source_block(G, Sigma_s, scatter_range, nu_Sigma_f, is_fissile, flux, scatter, fission);
+
+    for( int energy_group_in = 0; energy_group_in < G; energy_group_in++ )
+    {
+      float chi = Chi[energy_group_in];
+      float scale = 1.0f / Sigma_t[energy_group_in];
+      float * s = scatter + energy_group_in * SOURCE_UPDATE_BLOCK_SIZE;
+
+      #pragma omp simd
+      for( int lane = 0; lane < SOURCE_UPDATE_BLOCK_SIZE; lane++ )
+        s[lane] = (s[lane] + fission[lane] * chi * inverse_k_eff) * scale;
+    }
+
+    for( int lane = 0; lane < n_cells; lane++ )
+    {
+      float * source_gradient = CD.source_gradient + (uint64_t) cells[lane] * G * 2 + dimension;
+      for( int energy_group = 0; energy_group < G; energy_group++ )
+        source_gradient[energy_group * 2] = scatter[energy_group * SOURCE_UPDATE_BLOCK_SIZE + lane];
+    }
+  }
+}
+
+// Updates the sources of a block of up to SOURCE_UPDATE_BLOCK_SIZE cells, all of
+// the given material
+void update_isotropic_sources_blocked_kernel(Parameters P, SimulationData SD, int material_id, const int * cells, int n_cells, double inverse_k_eff)
+{
+  #define UPDATE_ISOTROPIC_SOURCES_BLOCK(G) update_isotropic_sources_block(P, SD, G, material_id, cells, n_cells, inverse_k_eff)
+  SPECIALIZE_ON_GROUP_COUNT(P, UPDATE_ISOTROPIC_SOURCES_BLOCK);
+  #undef UPDATE_ISOTROPIC_SOURCES_BLOCK
+}
@@ -1,19 +1,14 @@
 #include "minray.h"
+#include "group_specialization.h"
 
-void update_isotropic_sources_kernel(Parameters P, SimulationData SD, int cell, int energy_group_in, double inverse_k_eff)
+SPECIALIZED_INLINE void update_isotropic_source(Parameters P, SimulationData SD, const int G, int cell, int energy_group_in, double inverse_k_eff)
 {
-  // Cull threads if oversubscribed
-  if( cell >= P.n_cells )
-    return;
-  if( energy_group_in >= P.n_energy_groups )
-    return;
-
   int material_id = SD.readOnlyData.material_id[cell];
 
-  const uint64_t scalar_flux_idx = cell * P.n_energy_groups;
-  const int XS_base = material_id * P.n_energy_groups;
+  const uint64_t scalar_flux_idx = (uint64_t) cell * G;
+  const int XS_base = material_id * G;
 
-  const float * Sigma_s = SD.readOnlyData.Sigma_s + XS_base * P.n_energy_groups + energy_group_in * P.n_energy_groups;
+  const float * Sigma_s = SD.readOnlyData.Sigma_s + XS_base * G + energy_group_in * G;
   const float * nu_Sigma_f = SD.readOnlyData.nu_Sigma_f + XS_base;
 
   const float * scalar_flux = SD.readWriteData.cellData.old_scalar_flux + scalar_flux_idx;
@@ -21,17 +16,64 @@ void update_isotropic_sources_kernel(Parameters P, SimulationData SD, int cell,
   float Chi =     SD.readOnlyData.Chi[    XS_base + energy_group_in];
   float Sigma_t = SD.readOnlyData.Sigma_t[XS_base + energy_group_in];
 
+  // Only the nonzero band of the scattering matrix row is summed, and the fission
+  // source is only summed for fissile materials (skipping zero terms leaves the
+  // sums unchanged)
+  const int * scatter_range = SD.readOnlyData.scatter_group_range + (XS_base + energy_group_in) * 2;
+  int is_fissile = SD.readOnlyData.is_fissile[material_id];
+
   float scatter_source = 0.0;
   float fission_source = 0.0;
 
-  for( int energy_group_out = 0; energy_group_out < P.n_energy_groups; energy_group_out++ )
-  {
+  for( int energy_group_out = scatter_range[0]; energy_group_out < scatter_range[1]; energy_group_out++ )
     scatter_source += Sigma_s[   energy_group_out] * scalar_flux[energy_group_out];
-    fission_source += nu_Sigma_f[energy_group_out] * scalar_flux[energy_group_out];
-  }
+  if( is_fissile )
+    for( int energy_group_out = 0; energy_group_out < G; energy_group_out++ )
+      fission_source += nu_Sigma_f[energy_group_out] * scalar_flux[energy_group_out];
 
   fission_source *= Chi * inverse_k_eff;
   float new_isotropic_source = (scatter_source + fission_source)  / Sigma_t;
   SD.readWriteData.cellData.isotropic_source[scalar_flux_idx + energy_group_in] = new_isotropic_source;
+
+  if( P.source_type != LINEAR_SOURCE )
+    return;
+
+  // The source gradient is found from the scalar flux gradients in the same way
+  const float * flux_gradient = SD.readWriteData.cellData.old_flux_gradient + (uint64_t) cell * P.n_flux_gradient_entries;
+
+  float scatter_gradient_x = 0.0f;
+  float scatter_gradient_y = 0.0f;
+  float fission_gradient_x = 0.0f;
+  float fission_gradient_y = 0.0f;
+
+  for( int energy_group_out = scatter_range[0]; energy_group_out < scatter_range[1]; energy_group_out++ )
+  {
+    scatter_gradient_x += Sigma_s[   energy_group_out] * flux_gradient[energy_group_out * 2];
+    scatter_gradient_y += Sigma_s[   energy_group_out] * flux_gradient[energy_group_out * 2 + 1];
+  }
+  if( is_fissile )
+    for( int energy_group_out = 0; energy_group_out < G; energy_group_out++ )
+    {
+      fission_gradient_x += nu_Sigma_f[energy_group_out] * flux_gradient[energy_group_out * 2];
+      fission_gradient_y += nu_Sigma_f[energy_group_out] * flux_gradient[energy_group_out * 2 + 1];
+    }
+
+  float scale = 1.0f / Sigma_t;
+  float * source_gradient = SD.readWriteData.cellData.source_gradient + (scalar_flux_idx + energy_group_in) * 2;
+  source_gradient[0] = (scatter_gradient_x + fission_gradient_x * Chi * inverse_k_eff) * scale;
+  source_gradient[1] = (scatter_gradient_y + fission_gradient_y * Chi * inverse_k_eff) * scale;
 }
 
+
+void update_isotropic_sources_kernel(Parameters P, SimulationData SD, int cell, int energy_group_in, double inverse_k_eff)
+{
+  // Cull threads if oversubscribed
+  if( cell >= P.n_cells )
+    return;
+  if( energy_group_in >= P.n_energy_groups )
+    return;
+
+  #define UPDATE_ISOTROPIC_SOURCE(G) update_isotropic_source(P, SD, G, cell, energy_group_in, inverse_k_eff)
+  SPECIALIZE_ON_GROUP_COUNT(P, UPDATE_ISOTROPIC_SOURCE);
+  #undef UPDATE_ISOTROPIC_SOURCE
+}
@@ -12,6 +12,42 @@ double get_time(void)
   return (double) time / (double) CLOCKS_PER_SEC;
 }
 
+int get_thread_num(void)
+{
+  #ifdef OPENMP
+  return omp_get_thread_num();
+  #endif
+
+  return 0;
+}
+
+int get_max_threads(void)
+{
+  #ifdef OPENMP
+  return omp_get_max_threads();
+  #endif
+
+  return 1;
+}
+
+// Spreads the lower 32 bits of x out to the even bits of a 64 bit integer
+uint64_t interleave_bits(uint32_t x)
+{
+  uint64_t v = x;
+  v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+  v = (v | (v <<  8)) & 0x00FF00FF00FF00FFULL;
+  v = (v | (v <<  4)) & 0x0F0F0F0F0F0F0F0FULL;
+  v = (v | (v <<  2)) & 0x3333333333333333ULL;
+  v = (v | (v <<  1)) & 0x5555555555555555ULL;
+  return v;
+}
+
+// Returns the Z-order (Morton) index of a 2D coordinate
+uint64_t morton_encode(uint32_t x, uint32_t y)
+{
+  return interleave_bits(x) | (interleave_bits(y) << 1);
+}
+
 void ptr_swap(float ** a, float ** b)
 {
   float * tmp = *a;
@@ -256,7 +256,8 @@ OpenCLInfo initialize_device(int user_platform_id, int user_device_id)
 
   // Create a command queue
   //cl_command_queue command_queue = clCreateCommandQueueWithProperties(context, device_id, 0, &ret);
-  cl_command_queue command_queue = clCreateCommandQueue(context, device_id, 0, &ret);
+  // Profiling is enabled so that each kernel can be timed individually
+  cl_command_queue command_queue = clCreateCommandQueue(context, device_id, CL_QUEUE_PROFILING_ENABLE, &ret);
   check(ret);
 
   OpenCLInfo CL;
@@ -264,6 +265,8 @@ OpenCLInfo initialize_device(int user_platform_id, int user_device_id)
   CL.device_id = device_id;
   CL.context = context;
   CL.command_queue = command_queue;
+  memset(&CL.timers, 0, sizeof(PhaseTimers));
+  CL.n_pending_events = 0;
   return CL;
 }
 
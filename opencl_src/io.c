@@ -121,19 +121,101 @@ int print_results(Parameters P, SimulationResult SR)
   printf("k-effective                       = %.5f\n", SR.k_eff);
   printf("k-effective std. dev.             = %.5f\n", SR.k_eff_std_dev);
   printf("Simulation Runtime                = %.3le [s]\n", SR.runtime_total);
-  //printf("    Transport Sweep Time          = %.3le [s] (%.2lf%%)\n", SR.runtime_transport_sweep, 100.0 * SR.runtime_transport_sweep / SR.runtime_total);
-  //printf("    Iteration Time                = %.3le [s] (%.2lf%%)\n", SR.runtime_total - SR.runtime_transport_sweep, 100.0* (1.0 - SR.runtime_transport_sweep / SR.runtime_total));
+  printf("    Transport Sweep Time          = %.3le [s] (%.2lf%%)\n", SR.runtime_transport_sweep, 100.0 * SR.runtime_transport_sweep / SR.runtime_total);
+  printf("    Iteration Time                = %.3le [s] (%.2lf%%)\n", SR.runtime_total - SR.runtime_transport_sweep, 100.0* (1.0 - SR.runtime_transport_sweep / SR.runtime_total));
   printf("Number of Geometric Intersections = %.3le\n", (double) SR.n_geometric_intersections);
   printf("Avg. Geom. Intersections per Ray  = %.1lf\n", SR.n_geometric_intersections / ((double)P.n_rays * P.n_iterations));
   printf("Number of Integrations            = %.3le\n", (double) SR.n_geometric_intersections * P.n_energy_groups);
   double time_per_integration = SR.runtime_total * 1.0e9 / ( SR.n_geometric_intersections * P.n_energy_groups);
   printf("Time per Integration (TPI)        = %.3lf [ns]\n", time_per_integration);
   printf("Est. Total Time Req. to Converge  = %.3le [s]\n", (SR.runtime_total / P.n_iterations) * 2000.0);
+  print_phase_timers(P, SR);
   int is_valid_result = validate_results(P.validation_problem_id, SR.k_eff);
   border_print();
   return is_valid_result;
 }
 
+// Prints the device time spent in each phase of the power iteration. Throughput is
+// given in segments per second (i.e., the total number of geometric intersections
+// divided by the phase time), along with an estimate of the memory bandwidth the
+// phase achieved. Host side time (e.g., launch overhead and data transfers) is
+// reported as "Other".
+void print_phase_timers(Parameters P, SimulationResult SR)
+{
+  border_print();
+  center_print("KERNEL TIMING", 79);
+  border_print();
+  printf("%-26s %10s %10s %14s %12s\n", "Phase", "Time [s]", "% Runtime", "Segments/s", "Est. GB/s");
+
+  double time_in_phases = 0.0;
+  for( int phase = 0; phase < N_PHASES; phase++ )
+  {
+    if( SR.timers.n_calls[phase] == 0 )
+      continue;
+    double time = SR.timers.time[phase];
+    double bytes = estimate_phase_bytes(P, phase, SR.n_geometric_intersections);
+    printf("%-26s %10.3le %9.2lf%% %14.3le %12.2lf\n", get_phase_name(phase), time, 100.0 * time / SR.runtime_total,
+        SR.n_geometric_intersections / time, bytes / time / 1.0e9);
+    time_in_phases += time;
+  }
+  double time_other = SR.runtime_total - time_in_phases;
+  printf("%-26s %10.3le %9.2lf%%\n", "Other", time_other, 100.0 * time_other / SR.runtime_total);
+  border_print();
+}
+
+// Writes the inputs, results, and per-phase timings in JSON format
+void write_summary(Parameters P, SimulationResult SR, int is_valid_result, const char * summary_file)
+{
+  FILE * fp = fopen(summary_file, "w");
+  if( fp == NULL )
+  {
+    printf("ERROR: Unable to open summary file \"%s\" for writing\n", summary_file);
+    return;
+  }
+
+  char * validation_strings[4] = {"none", "small", "medium", "large"};
+
+  fprintf(fp, "{\n");
+  fprintf(fp, "  \"version\": \"%s\",\n", VERSION);
+  fprintf(fp, "  \"inputs\": {\n");
+  fprintf(fp, "    \"n_cells_per_dimension\": %d,\n", P.n_cells_per_dimension);
+  fprintf(fp, "    \"n_cells\": %lu,\n", P.n_cells);
+  fprintf(fp, "    \"n_energy_groups\": %d,\n", P.n_energy_groups);
+  fprintf(fp, "    \"n_rays\": %lu,\n", P.n_rays);
+  fprintf(fp, "    \"distance_per_ray\": %.6lf,\n", P.distance_per_ray);
+  fprintf(fp, "    \"n_inactive_iterations\": %d,\n", P.n_inactive_iterations);
+  fprintf(fp, "    \"n_active_iterations\": %d,\n", P.n_active_iterations);
+  fprintf(fp, "    \"seed\": %lu,\n", P.seed);
+  fprintf(fp, "    \"platform_id\": %d,\n", P.platform_id);
+  fprintf(fp, "    \"device_id\": %d\n", P.device_id);
+  fprintf(fp, "  },\n");
+  fprintf(fp, "  \"results\": {\n");
+  fprintf(fp, "    \"k_eff\": %.7lf,\n", SR.k_eff);
+  fprintf(fp, "    \"k_eff_std_dev\": %.7lf,\n", SR.k_eff_std_dev);
+  fprintf(fp, "    \"runtime_total\": %.6le,\n", SR.runtime_total);
+  fprintf(fp, "    \"runtime_transport_sweep\": %.6le,\n", SR.runtime_transport_sweep);
+  fprintf(fp, "    \"n_geometric_intersections\": %lu,\n", SR.n_geometric_intersections);
+  fprintf(fp, "    \"time_per_integration_ns\": %.6lf,\n", SR.runtime_total * 1.0e9 / ( SR.n_geometric_intersections * P.n_energy_groups));
+  fprintf(fp, "    \"validation_problem\": \"%s\",\n", validation_strings[P.validation_problem_id]);
+  fprintf(fp, "    \"validation_passed\": %s\n", (P.validation_problem_id && is_valid_result == 0) ? "true" : "false");
+  fprintf(fp, "  },\n");
+  fprintf(fp, "  \"phases\": [\n");
+  int is_first = 1;
+  for( int phase = 0; phase < N_PHASES; phase++ )
+  {
+    if( SR.timers.n_calls[phase] == 0 )
+      continue;
+    double time = SR.timers.time[phase];
+    double bytes = estimate_phase_bytes(P, phase, SR.n_geometric_intersections);
+    fprintf(fp, "%s    {\"name\": \"%s\", \"time\": %.6le, \"calls\": %lu, \"segments_per_second\": %.6le, \"est_bytes\": %.6le, \"est_gb_per_second\": %.6lf}",
+        is_first ? "" : ",\n", get_phase_key(phase), time, SR.timers.n_calls[phase], SR.n_geometric_intersections / time, bytes, bytes / time / 1.0e9);
+    is_first = 0;
+  }
+  fprintf(fp, "\n  ]\n");
+  fprintf(fp, "}\n");
+  fclose(fp);
+}
+
 void print_status_data(int iter, double k_eff, double percent_missed, int is_active_region, double k_eff_total_accumulator, double k_eff_sum_of_squares_accumulator, int n_active_iterations)
 {
   char color[64] = "";
@@ -179,12 +261,13 @@ void print_CLI_error(void)
   printf("    -v <small, medium, large>    Executes a specific validation probem to test for correctness\n");
   printf("    -P <platform id>             Manually specify the OpenCL platform id to run on\n");
   printf("    -D <device id>               Manually specify the OpenCL device id to run on\n");
+  printf("    --summary <file>             Write a machine-readable (JSON) summary of the results\n");
 
   printf("See readme for full description of default run values\n");
   exit(1);
 }
 
-Parameters read_CLI(int argc, char * argv[])
+Parameters read_CLI(int argc, char * argv[], char ** summary_file)
 {
   int problem_size_multiplier = 16;
 
@@ -287,6 +370,14 @@ Parameters read_CLI(int argc, char * argv[])
       else
         print_CLI_error();
     }
+    // machine-readable summary
+    else if( strcmp(arg, "--summary") == 0 )
+    {
+      if( ++i < argc )
+        *summary_file = argv[i];
+      else
+        print_CLI_error();
+    }
     // validation problem selection
     else if( strcmp(arg, "-v") == 0 )
     {
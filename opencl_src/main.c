@@ -2,8 +2,10 @@
 
 int main(int argc, char * argv[])
 {
-  // Read user inputs from command line
-  Parameters P = read_CLI(argc, argv);
+  // Read user inputs from command line. The summary file name is kept out of
+  // Parameters, which is passed by value to every kernel.
+  char * summary_file = NULL;
+  Parameters P = read_CLI(argc, argv, &summary_file);
 
   // Display inputs and derived inputs
   print_user_inputs(P);
@@ -33,6 +35,10 @@ int main(int argc, char * argv[])
   // Display Results
   int is_valid_result = print_results(P, SR);
 
+  // Output machine-readable summary if enabled
+  if(summary_file != NULL)
+    write_summary(P, SR, is_valid_result, summary_file);
+
   // Output VTK plotting file if enabled
   if(P.plotting_enabled)
     plot_3D_vtk(P, SD.readWriteData.cellData.scalar_flux_accumulator, SD.readOnlyData.material_id);
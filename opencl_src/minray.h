@@ -18,6 +18,20 @@
 #define MEDIUM 2
 #define LARGE 3
 
+// Timed phases of each power iteration
+#define PHASE_RAY_TRACE 0
+#define PHASE_FLUX_ATTENUATION 1
+#define PHASE_UPDATE_ISOTROPIC_SOURCES 2
+#define PHASE_NORMALIZE_SCALAR_FLUX 3
+#define PHASE_ADD_SOURCE_TO_SCALAR_FLUX 4
+#define PHASE_COMPUTE_K_EFF 5
+#define PHASE_REDUCTIONS 6
+#define N_PHASES 7
+
+// Kernel profiling events held between sync points (at most 11 kernels are
+// launched per power iteration)
+#define MAX_PENDING_KERNEL_EVENTS 16
+
 
 typedef struct{
   cl_kernel ray_trace_kernel;
@@ -30,12 +44,23 @@ typedef struct{
   cl_kernel reduce_float_kernel;
 } Kernels;
 
+typedef struct{
+  double time[N_PHASES];
+  uint64_t n_calls[N_PHASES];
+} PhaseTimers;
+
 typedef struct{
   cl_platform_id platform_id;
   cl_device_id device_id;
   cl_context context;
   cl_command_queue command_queue;
   Kernels kernels;
+  // Device execution time of each phase, from kernel profiling events
+  PhaseTimers timers;
+  // Profiling events of the kernels launched since the last sync point, and their phases
+  cl_event pending_events[MAX_PENDING_KERNEL_EVENTS];
+  int pending_phases[MAX_PENDING_KERNEL_EVENTS];
+  int n_pending_events;
 } OpenCLInfo;
 
 typedef struct{
@@ -134,14 +159,17 @@ typedef struct{
   double runtime_transport_sweep;
   double k_eff;
   double k_eff_std_dev;
+  PhaseTimers timers;
 } SimulationResult;
 
 // io.c
-Parameters read_CLI(int argc, char * argv[]);
+Parameters read_CLI(int argc, char * argv[], char ** summary_file);
 ReadOnlyData load_2D_C5G7_XS(Parameters P);
 void plot_3D_vtk(Parameters P, float * scalar_flux_accumulator, int * material_id);
 void print_user_inputs(Parameters P);
 int print_results(Parameters P, SimulationResult SR);
+void print_phase_timers(Parameters P, SimulationResult SR);
+void write_summary(Parameters P, SimulationResult SR, int is_valid_result, const char * summary_file);
 void print_status_data(int iter, double k_eff, double percent_missed, int is_active_region, double k_eff_total_accumulator, double k_eff_sum_of_squares_accumulator, int n_active_iterations);
 void center_print(const char *s, int width);
 void border_print(void);
@@ -156,7 +184,7 @@ void normalize_scalar_flux(OpenCLInfo * CL, Parameters P, SimulationData SD);
 void add_source_to_scalar_flux(OpenCLInfo * CL, Parameters P, SimulationData SD);
 double reduce_sum_float(float * a, int size);
 int reduce_sum_int(int * a, int size);
-double compute_k_eff(OpenCLInfo * CL, Parameters P, SimulationData SD, double old_k_eff);
+double compute_k_eff(OpenCLInfo * CL, Parameters P, SimulationData SD, double old_k_eff, double * total_fission_rate);
 void compute_cell_fission_rates(OpenCLInfo * CL, Parameters P, SimulationData SD, double utility_variable);
 double check_hit_rate(OpenCLInfo * CL, SimulationData SD, int n_cells);
 float reduce_fission_rates(OpenCLInfo *CL, SimulationData SD, int n_cells);
@@ -181,6 +209,13 @@ void ptr_swap(float ** a, float ** b);
 void compute_statistics(double sum, double sum_of_squares, int n, double * sample_mean, double * std_dev_of_sample_mean);
 int validate_results(int validation_problem_id, double k_eff);
 
+// timers.c
+const char * get_phase_name(int phase);
+const char * get_phase_key(int phase);
+void record_kernel_time(OpenCLInfo * CL, int phase, cl_event event);
+void collect_kernel_times(OpenCLInfo * CL);
+double estimate_phase_bytes(Parameters P, int phase, uint64_t n_segments);
+
 // cl_utils.c
 const char *getErrorString(cl_int error);
 void check(cl_int error);
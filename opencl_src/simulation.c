@@ -11,6 +11,10 @@ SimulationResult run_simulation(OpenCLInfo * CL, Parameters P, SimulationData SD
   double k_eff_total_accumulator = 0.0;
   double k_eff_sum_of_squares_accumulator = 0.0;
 
+  // Total fission rate of the old scalar flux, carried over from the previous
+  // iteration's new scalar flux (zero until the first iteration computes it)
+  double total_fission_rate = 0.0;
+
   // Indicator for if the simulation is in the active region
   int is_active_region = 0;
 
@@ -50,7 +54,7 @@ SimulationResult run_simulation(OpenCLInfo * CL, Parameters P, SimulationData SD
     add_source_to_scalar_flux(CL, P, SD);
 
     // Compute a new estimate of the eigenvalue based on the old and new scalar fluxes
-    k_eff = compute_k_eff(CL, P, SD, k_eff);
+    k_eff = compute_k_eff(CL, P, SD, k_eff, &total_fission_rate);
     k_eff_total_accumulator += k_eff;
     k_eff_sum_of_squares_accumulator += k_eff * k_eff;
 
@@ -61,6 +65,10 @@ SimulationResult run_simulation(OpenCLInfo * CL, Parameters P, SimulationData SD
     // Compute the total number of intersections performed this iteration
     n_total_geometric_intersections += reduce_intersections(CL, SD, P.n_rays);
 
+    // Add this iteration's kernel execution times to their phases, now that the
+    // kernels have completed
+    collect_kernel_times(CL);
+
     // Output some status data on the results of the power iteration
     print_status_data(iter, k_eff, percent_missed, is_active_region, k_eff_total_accumulator, k_eff_sum_of_squares_accumulator, iter - P.n_inactive_iterations + 1);
 
@@ -73,6 +81,8 @@ SimulationResult run_simulation(OpenCLInfo * CL, Parameters P, SimulationData SD
   compute_statistics(k_eff_total_accumulator, k_eff_sum_of_squares_accumulator, P.n_active_iterations, &SR.k_eff, &SR.k_eff_std_dev);
   SR.n_geometric_intersections = n_total_geometric_intersections;
   SR.runtime_total = runtime_total;
+  SR.runtime_transport_sweep = CL->timers.time[PHASE_RAY_TRACE] + CL->timers.time[PHASE_FLUX_ATTENUATION];
+  SR.timers = CL->timers;
 
   // Copy final flux accumulator vector back to the host 
   copy_array_from_device(CL, &SD.readWriteData.cellData.d_scalar_flux_accumulator, SD.readWriteData.cellData.scalar_flux_accumulator, SD.readWriteData.cellData.sz_scalar_flux_accumulator);
@@ -84,6 +94,8 @@ void update_isotropic_sources(OpenCLInfo * CL, Parameters P, SimulationData SD,
 {
   double inv_k_eff = 1.0/k_eff;
 
+  cl_event event;
+
   // Update argument
   cl_int ret = clSetKernelArg(CL->kernels.update_isotropic_sources_kernel, 0, sizeof(double), (void *)&inv_k_eff);
   check(ret);
@@ -91,27 +103,31 @@ void update_isotropic_sources(OpenCLInfo * CL, Parameters P, SimulationData SD,
   // Launch kernel
   size_t global_item_size = P.n_cells * P.n_energy_groups;
   size_t local_item_size = P.n_energy_groups;
-  ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.update_isotropic_sources_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, NULL);
+  ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.update_isotropic_sources_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, &event);
   check(ret);
+  record_kernel_time(CL, PHASE_UPDATE_ISOTROPIC_SOURCES, event);
 }
 
 void transport_sweep(OpenCLInfo * CL, Parameters P, SimulationData SD)
 {
   size_t global_item_size;
   size_t local_item_size;
+  cl_event event;
   cl_int ret;
 
   // Launch Ray Tracing kernel
   global_item_size = P.n_rays;
   local_item_size = 8; 
-  ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.ray_trace_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, NULL);
+  ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.ray_trace_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, &event);
   check(ret);
+  record_kernel_time(CL, PHASE_RAY_TRACE, event);
 
-  // Launch Ray Tracing kernel
+  // Launch Flux Attenuation kernel
   global_item_size = P.n_rays * P.n_energy_groups;
   local_item_size = P.n_energy_groups;
-  ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.flux_attenuation_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, NULL);
+  ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.flux_attenuation_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, &event);
   check(ret);
+  record_kernel_time(CL, PHASE_FLUX_ATTENUATION, event);
 }
 
 
@@ -119,31 +135,43 @@ void normalize_scalar_flux(OpenCLInfo * CL, Parameters P, SimulationData SD)
 {
   size_t global_item_size = P.n_cells * P.n_energy_groups;
   size_t local_item_size = P.n_energy_groups;
-  cl_int ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.normalize_scalar_flux_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, NULL);
+  cl_event event;
+  cl_int ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.normalize_scalar_flux_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, &event);
   check(ret);
+  record_kernel_time(CL, PHASE_NORMALIZE_SCALAR_FLUX, event);
 }
 
 void add_source_to_scalar_flux(OpenCLInfo * CL, Parameters P, SimulationData SD)
 {
   size_t global_item_size = P.n_cells * P.n_energy_groups;
   size_t local_item_size = P.n_energy_groups;
-  cl_int ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.add_source_to_scalar_flux_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, NULL);
+  cl_event event;
+  cl_int ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.add_source_to_scalar_flux_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, &event);
   check(ret);
+  record_kernel_time(CL, PHASE_ADD_SOURCE_TO_SCALAR_FLUX, event);
 }
 
-double compute_k_eff(OpenCLInfo * CL, Parameters P, SimulationData SD, double old_k_eff)
+// The total fission rate of the old scalar flux is the new total of the previous
+// iteration, so is passed in rather than recomputed (unless it is zero, i.e.,
+// unknown). It is replaced by the new total on return.
+double compute_k_eff(OpenCLInfo * CL, Parameters P, SimulationData SD, double old_k_eff, double * total_fission_rate)
 {
-  // Compute old fission rates
-  compute_cell_fission_rates(CL, P, SD, 0.0);
+  double old_total_fission_rate = *total_fission_rate;
+  if( old_total_fission_rate <= 0.0 )
+  {
+    // Compute old fission rates
+    compute_cell_fission_rates(CL, P, SD, 0.0);
 
-  // Reduce total old fission rate
-  double old_total_fission_rate = reduce_fission_rates(CL, SD, P.n_cells);
+    // Reduce total old fission rate
+    old_total_fission_rate = reduce_fission_rates(CL, SD, P.n_cells);
+  }
 
   // Compute new fission rates
   compute_cell_fission_rates(CL, P, SD, 1.0);
 
   // Reduce total new fission rate
   double new_total_fission_rate = reduce_fission_rates(CL, SD, P.n_cells);
+  *total_fission_rate = new_total_fission_rate;
 
   // Update estimate of k-eff
   double new_k_eff = old_k_eff * (new_total_fission_rate / old_total_fission_rate);
@@ -153,13 +181,15 @@ double compute_k_eff(OpenCLInfo * CL, Parameters P, SimulationData SD, double ol
 
 void compute_cell_fission_rates(OpenCLInfo * CL, Parameters P, SimulationData SD, double utility_variable)
 {
+  cl_event event;
   cl_int ret = clSetKernelArg(CL->kernels.compute_cell_fission_rates_kernel, 0, sizeof(double), (void *)&utility_variable);
   check(ret);
 
   size_t local_item_size = 64;
   size_t global_item_size = ceil(P.n_cells/64.0) * 64.0;
-  ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.compute_cell_fission_rates_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, NULL);
+  ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.compute_cell_fission_rates_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, &event);
   check(ret);
+  record_kernel_time(CL, PHASE_COMPUTE_K_EFF, event);
 }
 
 float reduce_fission_rates(OpenCLInfo *CL, SimulationData SD, int n_cells)
@@ -182,10 +212,12 @@ float reduce_fission_rates(OpenCLInfo *CL, SimulationData SD, int n_cells)
 
   set_kernel_arguments(&CL->kernels.reduce_float_kernel, argc, arg_sz, args);
 
+  cl_event event;
   size_t local_item_size = 256;
   size_t global_item_size = ceil(n_cells/(double) local_item_size) * local_item_size;
-  cl_int ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.reduce_float_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, NULL);
+  cl_int ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.reduce_float_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, &event);
   check(ret);
+  record_kernel_time(CL, PHASE_COMPUTE_K_EFF, event);
 
   copy_array_from_device(CL, &d_sum, (void *) &sum, sizeof(float));
 
@@ -215,10 +247,12 @@ int reduce_intersections(OpenCLInfo *CL, SimulationData SD, int n_rays)
 
   set_kernel_arguments(&CL->kernels.reduce_int_kernel, argc, arg_sz, args);
 
+  cl_event event;
   size_t local_item_size = 256;
   size_t global_item_size = ceil(n_rays/(double) local_item_size) * local_item_size;
-  cl_int ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.reduce_int_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, NULL);
+  cl_int ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.reduce_int_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, &event);
   check(ret);
+  record_kernel_time(CL, PHASE_REDUCTIONS, event);
 
   copy_array_from_device(CL, &d_sum, (void *) &sum, sizeof(int));
 
@@ -248,10 +282,12 @@ int reduce_hit_count(OpenCLInfo *CL, SimulationData SD, int n_cells)
 
   set_kernel_arguments(&CL->kernels.reduce_int_kernel, argc, arg_sz, args);
 
+  cl_event event;
   size_t local_item_size = 256;
   size_t global_item_size = ceil(n_cells/(double) local_item_size) * local_item_size;
-  cl_int ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.reduce_int_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, NULL);
+  cl_int ret = clEnqueueNDRangeKernel(CL->command_queue, CL->kernels.reduce_int_kernel, 1, NULL, &global_item_size, &local_item_size, 0, NULL, &event);
   check(ret);
+  record_kernel_time(CL, PHASE_REDUCTIONS, event);
 
   copy_array_from_device(CL, &d_sum, (void *) &sum, sizeof(int));
 
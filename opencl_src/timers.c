@@ -0,0 +1,131 @@
+#include "minray.h"
+
+// Each phase of the power iteration is timed individually, using OpenCL profiling
+// events to measure the time each kernel spends executing on the device. Alongside
+// the time, the number of bytes each phase moves to or from device memory is
+// estimated from the sizes of the arrays it streams through, so that an effective
+// bandwidth can be reported. Small, cache resident arrays (e.g., cross sections)
+// are not counted.
+
+static const char * phase_names[N_PHASES] = {
+  "Ray Trace",
+  "Flux Attenuation",
+  "Update Isotropic Sources",
+  "Normalize Scalar Flux",
+  "Add Source to Scalar Flux",
+  "Compute k-eff",
+  "Reductions"
+};
+
+static const char * phase_keys[N_PHASES] = {
+  "ray_trace",
+  "flux_attenuation",
+  "update_isotropic_sources",
+  "normalize_scalar_flux",
+  "add_source_to_scalar_flux",
+  "compute_k_eff",
+  "reductions"
+};
+
+const char * get_phase_name(int phase)
+{
+  return phase_names[phase];
+}
+
+const char * get_phase_key(int phase)
+{
+  return phase_keys[phase];
+}
+
+// Holds on to a kernel's profiling event, so that its execution time can be added
+// to a phase by collect_kernel_times once the kernel has completed. Waiting on each
+// kernel as it is launched would stall the queue between kernels.
+void record_kernel_time(OpenCLInfo * CL, int phase, cl_event event)
+{
+  if( CL->n_pending_events == MAX_PENDING_KERNEL_EVENTS )
+    collect_kernel_times(CL);
+
+  CL->pending_events[CL->n_pending_events] = event;
+  CL->pending_phases[CL->n_pending_events] = phase;
+  CL->n_pending_events++;
+}
+
+// Adds the execution times of all pending kernels to their phases. This is called
+// after the blocking read at the end of each power iteration, by which point the
+// kernels have completed, so the wait returns immediately.
+void collect_kernel_times(OpenCLInfo * CL)
+{
+  if( CL->n_pending_events == 0 )
+    return;
+
+  cl_int ret = clWaitForEvents(CL->n_pending_events, CL->pending_events);
+  check(ret);
+
+  for( int i = 0; i < CL->n_pending_events; i++ )
+  {
+    cl_ulong start, end;
+    cl_event event = CL->pending_events[i];
+    int phase = CL->pending_phases[i];
+
+    ret = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+    check(ret);
+    ret = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+    check(ret);
+    ret = clReleaseEvent(event);
+    check(ret);
+
+    CL->timers.time[phase] += (end - start) * 1.0e-9;
+    CL->timers.n_calls[phase]++;
+  }
+
+  CL->n_pending_events = 0;
+}
+
+// Returns the estimated number of bytes moved by a phase over the whole simulation
+double estimate_phase_bytes(Parameters P, int phase, uint64_t n_segments)
+{
+  double G = P.n_energy_groups;
+  double n_rays = P.n_rays;
+  double n_cells = P.n_cells;
+
+  // Ray location, direction, and cell id
+  double ray_state_bytes = 4 * sizeof(double) + sizeof(int);
+
+  // Cell id, distance, and vacuum flag
+  double segment_bytes = 2 * sizeof(int) + sizeof(double);
+
+  double per_iteration = 0.0;
+  double per_segment = 0.0;
+
+  switch( phase )
+  {
+    case PHASE_RAY_TRACE:
+      per_iteration = n_rays * (2 * ray_state_bytes + sizeof(int));
+      per_segment = segment_bytes + sizeof(int);
+      break;
+    case PHASE_FLUX_ATTENUATION:
+      // Each energy group is its own work item, so segments are read once per group
+      per_iteration = n_rays * (sizeof(int) + 2 * G * sizeof(float));
+      per_segment = G * (segment_bytes + sizeof(int) + 4 * sizeof(float));
+      break;
+    case PHASE_UPDATE_ISOTROPIC_SOURCES:
+      per_iteration = n_cells * (sizeof(int) + 2 * G * sizeof(float));
+      break;
+    case PHASE_NORMALIZE_SCALAR_FLUX:
+      per_iteration = n_cells * 2 * G * sizeof(float);
+      break;
+    case PHASE_ADD_SOURCE_TO_SCALAR_FLUX:
+      per_iteration = n_cells * (2 * sizeof(int) + 5 * G * sizeof(float));
+      break;
+    case PHASE_COMPUTE_K_EFF:
+      // Fission rates are computed and reduced for the new scalar flux only (the old
+      // total is carried over from the previous iteration)
+      per_iteration = n_cells * (sizeof(int) + G * sizeof(float) + 2 * sizeof(float));
+      break;
+    case PHASE_REDUCTIONS:
+      per_iteration = n_rays * sizeof(int) + n_cells * sizeof(int);
+      break;
+  }
+
+  return per_iteration * P.n_iterations + per_segment * n_segments;
+}